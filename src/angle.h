@@ -14,6 +14,7 @@
 #include "debugging.h"
 #include "event.h"
 #include "io.h"
+#include "profile.h"
 
 /** Perform all necessary changes in state and event data
  *  due to the addition or deletion of an angle.
@@ -37,6 +38,7 @@ inline void add_or_delete_angle (
         entity_type et3                     ///< [in] its type
         )
 {
+    PROFILE_SCOPE(PROF_ADD_OR_DELETE_ANGLE);
     if (debug) cout << "    " << ec2label[ec_angle] << " \"" << e2label[e1] << " " << rat2label[rat12] << " "
             << e2label[e2] << " " << rat2label[rat23] << " " << e2label[e3] << "\"" << endl;
 
@@ -145,8 +147,10 @@ inline angle_vec get_angles (
         const entity e3          ///< [in] target entity
         )
 {
-    // allocate mem for result:
-    angle_vec result(max(out1.size(), in3.size()) * n_rats * n_rats);
+    PROFILE_SCOPE(PROF_GET_ANGLES);
+    // allocate mem for result
+    // (each outleg can only pair with the at most n_rats inlegs from its target, and vice versa):
+    angle_vec result(min(out1.size(), in3.size()) * n_rats);
     // work with pointers (iterators):
     auto out1_it = out1.begin();
     auto in3_it = in3.begin();
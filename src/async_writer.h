@@ -0,0 +1,120 @@
+// make sure this file is only included once:
+#ifndef INC_ASYNC_WRITER_H
+#define INC_ASYNC_WRITER_H
+
+/** Background threads for output.
+ *
+ *  \file
+ *
+ *  The simulation thread only pushes compact records into a bounded lock-free
+ *  single-producer/single-consumer queue, and a background thread formats, compresses and writes them.
+ *  If the writer falls behind and the queue is full, the simulation thread waits (backpressure),
+ *  so memory use stays bounded.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#define ASYNC_QUEUE_LOG2_CAPACITY 16  ///< Queues hold 2^this many items
+#define ASYNC_FULL_WAIT_MICROSECONDS 50     ///< How long the producer sleeps when the queue is full
+#define ASYNC_EMPTY_WAIT_MICROSECONDS 1000  ///< How long the consumer sleeps when the queue is empty (long, to not steal cpu time from the simulation)
+
+/** A bounded lock-free queue for exactly one producer thread and one consumer thread.
+ *
+ *  Head and tail are ever-increasing counters; only the producer writes the tail
+ *  and only the consumer writes the head, so plain acquire/release ordering suffices.
+ */
+template <typename T>
+class spsc_queue
+{
+    std::vector<T> slots;
+    size_t mask;
+    alignas(64) std::atomic<size_t> head;  ///< No. of items popped so far (written by consumer)
+    alignas(64) std::atomic<size_t> tail;  ///< No. of items pushed so far (written by producer)
+
+public:
+    spsc_queue (int log2_capacity) : slots((size_t)1 << log2_capacity), mask(((size_t)1 << log2_capacity) - 1), head(0), tail(0) {}
+
+    /** Append an item, waiting while the queue is full.
+     */
+    void push (const T& x)
+    {
+        auto t = tail.load(std::memory_order_relaxed);
+        while (t - head.load(std::memory_order_acquire) == slots.size()) {
+            std::this_thread::sleep_for(std::chrono::microseconds(ASYNC_FULL_WAIT_MICROSECONDS));
+        }
+        slots[t & mask] = x;
+        tail.store(t + 1, std::memory_order_release);
+    }
+
+    /** Remove the oldest item if there is one.
+     *
+     *  \returns whether an item was removed
+     */
+    bool pop (T& x)
+    {
+        auto h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) return false;
+        x = slots[h & mask];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+};
+
+/** A background thread that handles all items pushed into its queue, in order.
+ */
+template <typename T>
+class async_writer
+{
+    spsc_queue<T> queue;
+    std::thread thread;
+    std::atomic<bool> stopping;
+    std::function<void(T&)> handle;
+
+    void run ()
+    {
+        T x;
+        while (true) {
+            if (queue.pop(x)) {
+                handle(x);
+            } else if (stopping.load(std::memory_order_acquire)) {
+                // the producer pushes nothing after setting stopping, so one more pass empties the queue:
+                while (queue.pop(x)) handle(x);
+                return;
+            } else {
+                std::this_thread::sleep_for(std::chrono::microseconds(ASYNC_EMPTY_WAIT_MICROSECONDS));
+            }
+        }
+    }
+
+public:
+    async_writer () : queue(ASYNC_QUEUE_LOG2_CAPACITY), stopping(false) {}
+
+    /** Start the background thread, which calls f(item) for each pushed item.
+     *  f must only read data that the simulation thread does not change meanwhile.
+     */
+    void start (std::function<void(T&)> f)
+    {
+        handle = f;
+        stopping = false;
+        thread = std::thread([this]() { run(); });
+    }
+
+    bool is_running () { return thread.joinable(); }
+
+    void push (const T& x) { queue.push(x); }
+
+    /** Wait until all pushed items have been handled, then end the background thread.
+     */
+    void stop ()
+    {
+        if (!thread.joinable()) return;
+        stopping.store(true, std::memory_order_release);
+        thread.join();
+    }
+};
+
+#endif
@@ -0,0 +1,439 @@
+/** tricl_bench, a benchmark suite of the hot kernels and of end-to-end runs
+ *
+ *  \file
+ *
+ *  Usage: ``tricl_bench [options] [config files]``
+ *
+ *  Microbenchmarks (unless --sweep-only) time \ref get_angles, \ref probunits2probability,
+ *  the scheduler operations (\ref schedule_event, \ref reschedule_event, \ref remove_event)
+ *  and \ref add_link / \ref delete_link on synthetic networks of one relationship type
+ *  whose out-degrees are constant, Poisson or power-law (exponent 2.5) distributed with several means.
+ *
+ *  The scaling sweep (unless --micro-only) runs the tricl executable on each given config file
+ *  (default: all *.yaml files in folder config_files) with its entity counts multiplied by each of several factors,
+ *  without output files and with a fixed no. of events, and reports events per second and peak memory.
+ *  Configs that fail (e.g. since they need data files) are reported with status "error".
+ *
+ *  Results are written as csv with columns
+ *  ``suite,benchmark,variant,entities,operations,seconds,ns per operation,operations per second,peak rss mb,status``.
+ *  With --compare, operations per second are compared to those of an earlier result file,
+ *  and the exit code is 2 if any benchmark got slower by more than --tolerance.
+ */
+
+#include <math.h>
+#include <chrono>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <unistd.h>
+
+#include <yaml-cpp/yaml.h>
+#include "3rdparty/cxxopts.hpp"
+
+#include "global_variables.h"
+#include "entity.h"
+#include "link.h"
+#include "probability.h"
+#include "angle.h"
+#include "event.h"
+#include "simulate.h"
+#include "io.h"
+
+std::mt19937_64 setup_rng(1);  ///< Only used to set up the synthetic networks, not by the timed kernels
+std::ostream* results;         ///< Where the csv rows go
+std::map<string, double> result_rates;  ///< Operations per second by "suite,benchmark,variant,entities"
+
+/** Write a csv row and register its rate for comparison.
+ */
+void report (
+        const string& suite,
+        const string& benchmark,
+        const string& variant,
+        long int entities,
+        long int operations,
+        double seconds,
+        double peak_rss = 0,
+        const string& status = "ok"
+        )
+{
+    char buf[256];
+    snprintf(buf, sizeof(buf), ",%ld,%ld,%.6f,%.1f,%.1f,%.0f,", entities, operations, seconds,
+            1e9 * seconds / max(operations, 1L), operations / max(seconds, 1e-9), peak_rss);
+    string key = csv_quoted(suite) + "," + csv_quoted(benchmark) + "," + csv_quoted(variant);
+    *results << key << buf << csv_quoted(status) << endl;
+    if (status == "ok") result_rates[key + "," + to_string(entities)] = operations / max(seconds, 1e-9);
+}
+
+/** \returns the wall time since t0 in seconds
+ */
+inline double seconds_since (std::chrono::steady_clock::time_point t0)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+/** Replace all non-identity links by a random network whose out-degrees have the given distribution and mean
+ *  (targets are drawn uniformly).
+ */
+void make_network (
+        entity n,                   ///< [in] no. of entities (ids 1...n)
+        relationship_or_action_type rat,
+        const string& distribution, ///< [in] "constant", "poisson", or "power law"
+        double mean_degree          ///< [in] mean out-degree
+        )
+{
+    for (entity e = 1; e <= n; e++) {
+        e2outs[e] = { { .rat_out = RT_ID, .e_target = e } };
+        e2ins[e]  = { { .e_source = e, .rat_in = RT_ID } };
+    }
+    lt2n.clear();
+    n_links = 0;
+    std::poisson_distribution<long int> poisson(mean_degree);
+    std::uniform_real_distribution<double> u01(0, 1);
+    std::uniform_int_distribution<entity> random_e(1, n);
+    for (entity e1 = 1; e1 <= n; e1++) {
+        long int d;
+        if (distribution == "constant") d = lround(mean_degree);
+        else if (distribution == "poisson") d = poisson(setup_rng);
+        else d = floor(mean_degree / 3 * pow(1 - u01(setup_rng), -1 / 1.5));  // Pareto with exponent 2.5 has mean 3 x_min
+        d = min(d, (long int) n / 10);
+        for (long int i = 0; i < d; i++) {
+            tricllink l = { .e1 = e1, .rat13 = rat, .e3 = random_e(setup_rng) };
+            if ((l.e3 != e1) && !link_exists(l)) add_link(l);
+        }
+    }
+}
+
+/** Run all microbenchmarks on one synthetic network.
+ */
+void bench_kernels (
+        entity n,
+        relationship_or_action_type rat,
+        const string& distribution,
+        double mean_degree,
+        long int n_ops
+        )
+{
+    make_network(n, rat, distribution, mean_degree);
+    char vbuf[64];
+    snprintf(vbuf, sizeof(vbuf), "%s, mean degree %g", distribution.c_str(), mean_degree);
+    string variant = vbuf;
+    std::uniform_int_distribution<entity> random_e(1, n);
+
+    // get_angles for random pairs:
+    vector<pair<entity, entity>> pairs(n_ops);
+    for (auto& p : pairs) p = { random_e(setup_rng), random_e(setup_rng) };
+    size_t n_angles_found = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (auto& [e1, e3] : pairs) n_angles_found += get_angles(e1, e2outs[e1], e2ins[e3], e3).size();
+    report("micro", "get_angles", variant, n, n_ops, seconds_since(t0));
+    if (n_angles_found == 1) cerr << "";  // (keeps the loop from being optimized away)
+
+    // add_link and delete_link of links that did not exist before:
+    vector<tricllink> new_links;
+    for (auto& [e1, e3] : pairs) {
+        tricllink l = { .e1 = e1, .rat13 = rat, .e3 = e3 };
+        if ((e1 != e3) && !link_exists(l)) new_links.push_back(l);
+    }
+    t0 = std::chrono::steady_clock::now();
+    long int n_added = 0;
+    for (auto& l : new_links) {
+        if (!link_exists(l)) {  // (a pair may have been drawn twice)
+            add_link(l);
+            n_added++;
+        }
+    }
+    report("micro", "add_link", variant, n, n_added, seconds_since(t0));
+    t0 = std::chrono::steady_clock::now();
+    long int n_deleted = 0;
+    for (auto& l : new_links) {
+        if (link_exists(l)) {
+            delete_link(l);
+            n_deleted++;
+        }
+    }
+    report("micro", "delete_link", variant, n, n_deleted, seconds_since(t0));
+
+    // scheduler operations with one termination event per link
+    // (with tail indices 0, all effective rates are 0.5, so that the total effective rate has no rounding errors):
+    vector<event> evs;
+    for (auto& [e1, outs] : e2outs) {
+        for (auto& leg : outs) {
+            if (leg.rat_out != RT_ID) evs.push_back({ .ec = EC_TERM, .e1 = e1, .rat13 = leg.rat_out, .e3 = leg.e_target });
+        }
+    }
+    for (auto& ev : evs) ev2data[ev] = { .n_angles = 0, .attempt_rate = 1.0, .success_probunits = 0.0, .effective_rate = 0.0 };
+    t0 = std::chrono::steady_clock::now();
+    for (auto& ev : evs) schedule_event(ev, &ev2data[ev], 0.0, 0.0);
+    report("micro", "schedule_event", variant, n, evs.size(), seconds_since(t0));
+    if (!evs.empty()) {
+        std::uniform_int_distribution<size_t> random_ev(0, evs.size() - 1);
+        vector<event*> to_reschedule(n_ops);
+        for (auto& p : to_reschedule) p = &evs[random_ev(setup_rng)];
+        t0 = std::chrono::steady_clock::now();
+        for (auto p : to_reschedule) reschedule_event(*p, &ev2data[*p], 0.0, 0.0);
+        report("micro", "reschedule_event", variant, n, n_ops, seconds_since(t0));
+    }
+    t0 = std::chrono::steady_clock::now();
+    for (auto& ev : evs) remove_event(ev, &ev2data[ev]);
+    report("micro", "remove_event", variant, n, evs.size(), seconds_since(t0));
+    t2ev.clear();
+    ev2data.clear();
+    total_finite_effective_rate = 0;
+}
+
+/** Time \ref probunits2probability for several tail indices.
+ */
+void bench_probability (long int n_ops)
+{
+    vector<probunits> pus(n_ops);
+    std::uniform_real_distribution<double> u(-10, 10);
+    for (auto& pu : pus) pu = u(setup_rng);
+    for (auto [left_tail, right_tail] : vector<pair<double, double>>{ {0, 0}, {1, 1}, {0.5, 2} }) {
+        double sum = 0;
+        auto t0 = std::chrono::steady_clock::now();
+        for (auto pu : pus) sum += probunits2probability(pu, left_tail, right_tail);
+        char vbuf[64];
+        snprintf(vbuf, sizeof(vbuf), "tails %g %g", left_tail, right_tail);
+        report("micro", "probunits2probability", vbuf, 0, n_ops, seconds_since(t0));
+        if (sum == -1) cerr << "";  // (keeps the loop from being optimized away)
+    }
+}
+
+/** Run tricl on a scaled copy of a config file and report its speed.
+ */
+void bench_config (
+        const string& tricl_path,
+        const string& config_filename,
+        double scale,
+        long int n_events,
+        const string& tmp_folder
+        )
+{
+    auto slash_pos = config_filename.rfind('/');
+    string name = (slash_pos == string::npos) ? config_filename : config_filename.substr(slash_pos + 1);
+    char vbuf[64];
+    snprintf(vbuf, sizeof(vbuf), "entities x %g", scale);
+    string status = "ok";
+    string tmp_filename = tmp_folder + "/tricl_bench_" + to_string(getpid()) + "_" + name;
+    try {
+        YAML::Node c = YAML::LoadFile(config_filename);
+        // no output files (also no diagrams and no separate gexf files of relationship types):
+        c.remove("files");
+        for (auto it : c["relationship types"]) {
+            if (it.second.IsMap()) it.second.remove("gexf");
+        }
+        // fixed no. of events, same time limit:
+        c["limits"]["events"] = n_events;
+        // scale the no. of entities of each type given as a number or expression (not those given as a list):
+        std::ostringstream factor;
+        factor << ")*" << scale;
+        for (auto it : c["entities"]) {
+            YAML::Node spec = it.second;
+            YAML::Node n = spec.IsMap() ? spec["n"] : spec;
+            if (n.IsScalar()) {
+                if (spec.IsMap()) spec["n"] = "(" + n.as<string>() + factor.str();
+                else c["entities"][it.first] = "(" + n.as<string>() + factor.str();
+            }
+        }
+        std::ofstream f(tmp_filename);
+        f << c << endl;
+    } catch (const YAML::Exception& e) {
+        status = string("error: ") + e.what();
+    }
+
+    long int entities = 0, events = 0;
+    double seconds = 0, peak_rss = 0;
+    if (status == "ok") {
+        string cmd = "'" + tricl_path + "' '" + tmp_filename + "' --quiet --seed 1 --threads 1 2>&1";
+        FILE* p = popen(cmd.c_str(), "r");
+        if (p == NULL) throw "cannot run tricl";
+        string output;
+        char buf[4096];
+        size_t n;
+        while ((n = fread(buf, 1, sizeof(buf), p)) > 0) output.append(buf, n);
+        int exit_code = pclose(p);
+        for (auto& c : output) if (c == '\r') c = '\n';
+        std::istringstream lines(output);
+        string line, error;
+        while (std::getline(lines, line)) {
+            long int ne;
+            double s, rate, r;
+            auto pos = line.find("\" has ");
+            if ((line.rfind(" entity type \"", 0) == 0) && (pos != string::npos)) entities += atol(line.c_str() + pos + 6);
+            pos = line.find(" | ");
+            while (pos != string::npos) {
+                // (the events per second are more precise than the seconds):
+                if (sscanf(line.c_str() + pos, " | %ld events in %lf s, %lf ev/s, peak RSS %lf MB", &ne, &s, &rate, &r) == 4) {
+                    events = ne; seconds = ne / max(rate, 1e-9); peak_rss = r;
+                }
+                pos = line.find(" | ", pos + 3);
+            }
+            if ((line.rfind("ERROR", 0) == 0) || (line.find("Assertion") != string::npos)
+                    || (line.rfind("terminate called", 0) == 0)) error = line;
+        }
+        if ((exit_code != 0) || (events == 0)) status = "error: " + ((error != "") ? error : "exit code " + to_string(exit_code));
+    }
+    unlink(tmp_filename.c_str());
+    report("sweep", name, vbuf, entities, events, seconds, peak_rss, status);
+}
+
+/** \returns all *.yaml files in a folder, sorted
+ */
+vector<string> yaml_files (const string& folder)
+{
+    vector<string> fns;
+    DIR* d = opendir(folder.c_str());
+    if (d == NULL) return fns;
+    while (auto entry = readdir(d)) {
+        string fn = entry->d_name;
+        if ((fn.size() > 5) && (fn.substr(fn.size() - 5) == ".yaml")) fns.push_back(folder + "/" + fn);
+    }
+    closedir(d);
+    std::sort(fns.begin(), fns.end());
+    return fns;
+}
+
+/** \returns the comma-separated numbers in s
+ */
+vector<double> number_list (const string& s)
+{
+    vector<double> xs;
+    std::istringstream ss(s);
+    string item;
+    while (std::getline(ss, item, ',')) xs.push_back(atof(item.c_str()));
+    return xs;
+}
+
+/** Compare the rates of this run with those in an earlier result file.
+ *
+ *  \returns whether no benchmark got slower by more than the tolerance
+ */
+bool compare_results (
+        const string& filename,
+        double tolerance  ///< [in] max. accepted relative slowdown
+        )
+{
+    std::ifstream f(filename);
+    if (!f) throw "cannot read comparison file";
+    string line;
+    std::getline(f, line);  // header
+    bool ok = true;
+    while (std::getline(f, line)) {
+        if (!line.empty() && (line.back() == '\r')) line.pop_back();
+        // split the row into fields, respecting quotes:
+        vector<string> fields(1);
+        bool quoted = false;
+        for (size_t i = 0; i < line.size(); i++) {
+            char c = line[i];
+            if (c == '"') {
+                if (quoted && (i + 1 < line.size()) && (line[i + 1] == '"')) { fields.back() += '"'; i++; }
+                else quoted = !quoted;
+            }
+            else if ((c == ',') && !quoted) fields.push_back("");
+            else fields.back() += c;
+        }
+        if ((fields.size() < 10) || (fields[9] != "ok")) continue;
+        string key = csv_quoted(fields[0]) + "," + csv_quoted(fields[1]) + "," + csv_quoted(fields[2]) + "," + fields[3];
+        auto it = result_rates.find(key);
+        if (it == result_rates.end()) continue;
+        double old_rate = atof(fields[7].c_str());
+        if (it->second < old_rate * (1 - tolerance)) {
+            cerr << "REGRESSION: " << key << ": " << it->second << " instead of " << old_rate << " operations per second" << endl;
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+int main (int argc, char *argv[])
+{
+    try
+    {
+        cxxopts::Options options("tricl_bench", "benchmark the hot kernels and end-to-end runs of tricl");
+        options.add_options()
+                ("help", "Print help")
+                ("configs", "config files for the scaling sweep (default: all *.yaml files in folder config_files)", cxxopts::value<vector<string>>())
+                ("micro-only", "only run the microbenchmarks")
+                ("sweep-only", "only run the scaling sweep")
+                ("entities", "no. of entities of the synthetic networks", cxxopts::value<long int>()->default_value("100000"))
+                ("degrees", "mean out-degrees of the synthetic networks", cxxopts::value<string>()->default_value("4,16,64"))
+                ("operations", "no. of operations per microbenchmark", cxxopts::value<long int>()->default_value("200000"))
+                ("scales", "factors for the no. of entities in the sweep", cxxopts::value<string>()->default_value("1,4"))
+                ("events", "no. of events per run in the sweep", cxxopts::value<long int>()->default_value("20000"))
+                ("tricl", "tricl executable (default: the one next to tricl_bench)", cxxopts::value<string>()->default_value(""))
+                ("tmp", "folder for the scaled config files", cxxopts::value<string>()->default_value("."))
+                ("output", "csv file for the results (default: standard output)", cxxopts::value<string>()->default_value(""))
+                ("compare", "earlier csv result file to compare to", cxxopts::value<string>()->default_value(""))
+                ("tolerance", "max. accepted relative slowdown w.r.t. --compare", cxxopts::value<double>()->default_value("0.2"))
+                ;
+        options.parse_positional({ "configs" });
+        options.positional_help("[config files]");
+        auto opts = options.parse(argc, argv);
+        if (opts.count("help") > 0) {
+            cout << options.help() << endl;
+            return 0;
+        }
+
+        std::ofstream results_file;
+        if (opts["output"].as<string>() != "") {
+            results_file.open(opts["output"].as<string>());
+            if (!results_file) throw "cannot write output file";
+            results = &results_file;
+        } else {
+            results = &cout;
+        }
+        *results << "suite,benchmark,variant,entities,operations,seconds,ns per operation,operations per second,peak rss mb,status" << endl;
+
+        if (opts.count("sweep-only") == 0) {
+            quiet = true;
+            verbose = false;
+            seed = 1;
+            init_randomness();
+            long int n_ops = opts["operations"].as<long int>();
+            entity n = opts["entities"].as<long int>();
+            if ((n < 2) || (n >= MAX_N_E)) throw "--entities must be at least 2 and less than the max. no. of entities";
+            entity_type et = 1;
+            relationship_or_action_type rat = 2;
+            et2label[et] = "node";
+            rat2label[rat] = "links to";
+            rat2inv[rat] = NO_RAT;
+            n_rats = rat2label.size();
+            for (entity e = 1; e <= n; e++) add_entity(et, "");
+            bench_probability(n_ops * 10);
+            for (string distribution : { "constant", "poisson", "power law" }) {
+                for (double k : number_list(opts["degrees"].as<string>())) bench_kernels(n, rat, distribution, k, n_ops);
+            }
+        }
+
+        if (opts.count("micro-only") == 0) {
+            string tricl_path = opts["tricl"].as<string>();
+            if (tricl_path == "") {
+                string self = argv[0];
+                auto slash_pos = self.rfind('/');
+                tricl_path = ((slash_pos == string::npos) ? "." : self.substr(0, slash_pos)) + "/tricl";
+            }
+            auto configs = (opts.count("configs") > 0) ? opts["configs"].as<vector<string>>() : yaml_files("config_files");
+            for (auto& fn : configs) {
+                for (double scale : number_list(opts["scales"].as<string>())) {
+                    bench_config(tricl_path, fn, scale, opts["events"].as<long int>(), opts["tmp"].as<string>());
+                }
+            }
+        }
+
+        if ((opts["compare"].as<string>() != "")
+                && !compare_results(opts["compare"].as<string>(), opts["tolerance"].as<double>())) return 2;
+    }
+    catch (const char* msg)
+    {
+        cerr << "ERROR: exiting with message: " << msg << endl;
+        return 1;
+    }
+    catch (const string& msg)
+    {
+        cerr << "ERROR: exiting with message: " << msg << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,89 @@
+/** tricl_bench_gexf, a benchmark of the gexf output
+ *
+ *  \file
+ *
+ *  Usage: ``tricl_bench_gexf [no. of edges] [output folder] [no. of compression threads]``
+ *
+ *  Writes the given no. of edges (default 2000000) between 1000 entities
+ *  through the same code path as a simulation (\ref init_gexf, \ref gexf_output_edge, \ref finish_gexf),
+ *  once to a .gexf file and once each to a .gexf.gz file with compression methods "gzip" and "parallel gzip"
+ *  (default: all hardware threads), and reports the edges written per second of wall time
+ *  (including the time the background thread needs to drain its queue and complete the file).
+ */
+
+#include <chrono>
+#include <sys/stat.h>
+#include <thread>
+
+#include "global_variables.h"
+#include "entity.h"
+#include "gexf.h"
+
+/** Write n_edges edges to file fn.
+ *
+ *  \returns edges per second
+ */
+double bench_gexf (
+        const string& fn,  ///< [in] name of (or path to) file
+        long int n_edges   ///< [in] no. of edges to write
+        )
+{
+    relationship_or_action_type rat = 2;
+    gexf_filename.clear();
+    gexf_filename[rat] = fn;
+    current_t = 0;
+    n_events = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    init_gexf();
+    entity e1 = 1, e3 = 2;
+    for (long int i = 0; i < n_edges; i++) {
+        // cycle through all pairs of distinct entities:
+        e3 = (e3 % max_e) + 1;
+        if (e3 == e1) {
+            e1 = (e1 % max_e) + 1;
+            e3 = (e1 % max_e) + 1;
+        }
+        tricllink l = { .e1 = e1, .rat13 = rat, .e3 = e3 };
+        timepoint start = current_t;
+        current_t += 1e-3 * (1 + i % 7);
+        n_events++;
+        gexf_output_edge(l, start);
+    }
+    finish_gexf();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    struct stat st;
+    long int size = (stat(fn.c_str(), &st) == 0) ? st.st_size : 0;
+    cout << fn << ": " << n_edges << " edges in " << seconds << " s = " << (long int) (n_edges / seconds)
+         << " edges/s, " << size << " bytes" << endl;
+    return n_edges / seconds;
+}
+
+int main (int argc, char *argv[])
+{
+    try
+    {
+        long int n_edges = (argc > 1) ? atol(argv[1]) : 2000000;
+        string folder = (argc > 2) ? string(argv[2]) + "/" : "";
+        n_threads = (argc > 3) ? atoi(argv[3]) : 0;
+        if (n_threads == 0) n_threads = max(1u, std::thread::hardware_concurrency());
+        quiet = true;
+        verbose = false;
+        entity_type et = 1;
+        et2label[et] = "node";
+        rat2label[2] = "links to";
+        rat2inv[2] = NO_RAT;
+        for (int i = 0; i < 1000; i++) add_entity(et, "");
+        max_t = 1e-3 * 4 * n_edges;
+        bench_gexf(folder + "bench.gexf", n_edges);
+        bench_gexf(folder + "bench.gexf.gz", n_edges);
+        gexf_compression[folder + "bench_parallel.gexf.gz"] = "parallel gzip";
+        cout << "(parallel gzip with " << n_threads << " threads:)" << endl;
+        bench_gexf(folder + "bench_parallel.gexf.gz", n_edges);
+    }
+    catch (const char* msg)
+    {
+        cerr << "ERROR: exiting with message: " << msg << endl;
+        return 1;
+    }
+    return 0;
+}
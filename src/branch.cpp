@@ -0,0 +1,102 @@
+/** Running several scenario branches from one snapshot, or several replicates from one initial state.
+ *
+ *  \file
+ *
+ *  Each branch listed in the config file's section "branches" is run in a separate child process
+ *  which reads the config file with the branch's metaparameter overrides, restores the state from the common snapshot
+ *  (a read-only memory mapping, so all branches share the same pages of the operating system's file cache),
+ *  and then builds its own schedule from the restored network.
+ *  Hence no branch repeats the burn-in or the construction of initial links.
+ *
+ *  Replicates (option --replicates) are forked only after initialization, so they share the parsed config,
+ *  the influence tables and the initial network copy-on-write (the tables are never written again)
+ *  and only redraw the times of the scheduled events from their own random stream.
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "global_variables.h"
+#include "branch.h"
+
+/** Fork one child process per label, at most \ref n_threads at a time.
+ *
+ *  Each child's output is redirected to "<config file name>_<label>.log".
+ *  The parent process waits for all children and then exits.
+ *
+ *  \returns the index of the child's label, 0...labels.size()-1
+ */
+static size_t fork_processes (
+        const vector<string>& labels,  ///< [in] labels of all children
+        const string& kind,            ///< [in] kind of children in log messages (singular)
+        const string& kinds            ///< [in] the same in plural
+        )
+{
+    if (!silent) cout << "RUNNING " << labels.size() << " " << kinds << " in up to " << n_threads << " processes..." << endl;
+    cout.flush();  // so that buffered output is not duplicated in the children
+    unordered_map<pid_t, string> pid2label;
+    int n_failed = 0;
+    auto wait_for_child = [&]() {
+        int status;
+        pid_t pid = wait(&status);
+        if (pid == -1) throw "waiting for child process failed";
+        bool ok = WIFEXITED(status) && (WEXITSTATUS(status) == 0);
+        if (!ok) n_failed++;
+        if (!silent) cout << " " << kind << " " << pid2label[pid] << (ok ? " finished" : " FAILED") << endl;
+        pid2label.erase(pid);
+    };
+    for (size_t i = 0; i < labels.size(); i++) {
+        if (pid2label.size() >= n_threads) wait_for_child();
+        pid_t pid = fork();
+        if (pid == -1) throw "cannot fork child process";
+        if (pid == 0) {
+            child_label = labels[i];
+            string log_filename = config_yaml_filename + "_" + labels[i] + ".log";
+            if (!freopen(log_filename.c_str(), "w", stdout)) throw "cannot write log file of child process";
+            return i;
+        }
+        pid2label[pid] = labels[i];
+    }
+    while (!pid2label.empty()) wait_for_child();
+    if (!silent) cout << "..." << kinds << " FINISHED." << endl;
+    exit((n_failed > 0) ? 1 : 0);
+}
+
+/** Select the branch to run in this process.
+ *
+ *  If a branch was selected on the command line (option --branch), just returns its no.
+ *  Otherwise forks one child process per branch (see \ref fork_processes)
+ *  and returns the branch's no. in each child.
+ *
+ *  \returns the no. of the branch to run, 1...labels.size()
+ */
+int select_branch (
+        const vector<string>& labels  ///< [in] labels of all branches
+        )
+{
+    if (branch_label != "") {
+        for (size_t i = 0; i < labels.size(); i++) {
+            if (labels[i] == branch_label) return i + 1;
+        }
+        throw "unknown branch";
+    }
+    auto i = fork_processes(labels, "branch", "BRANCHES");
+    branch_label = labels[i];
+    return i + 1;
+}
+
+/** Select the replicate to run in this process (option --replicates).
+ *
+ *  To be called once the initial state is complete but before any output file is opened.
+ *  Forks one child process per replicate (see \ref fork_processes), labelled "r<replicate no.>",
+ *  which inherits the initial state from this process without copying it.
+ *
+ *  \returns the replicate no. to run, \ref replicate...\ref replicate + \ref n_replicates - 1
+ */
+unsigned long select_replicate ()
+{
+    vector<string> labels;
+    for (unsigned long k = 0; k < n_replicates; k++) labels.push_back("r" + to_string(replicate + k));
+    return replicate + fork_processes(labels, "replicate", "REPLICATES");
+}
@@ -0,0 +1,13 @@
+// make sure this file is only included once:
+#ifndef INC_BRANCH_H
+#define INC_BRANCH_H
+
+#include "data_model.h"
+
+#define REPLICATE_STREAM 0xffffffffu  ///< Id of the random stream of a replicate's dynamics (branches use 1...)
+
+int select_branch (const vector<string>& labels);
+
+unsigned long select_replicate ();
+
+#endif
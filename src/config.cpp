@@ -10,6 +10,7 @@
 #include <limits.h>
 #include <math.h>
 #include <iostream>
+#include <thread>
 #include "yaml-cpp/yaml.h"
 #include "3rdparty/tinyexpr.h"   // for handling of expressions
 #include "3rdparty/cxxopts.hpp"  // for handling of command line options
@@ -17,16 +18,31 @@
 #include "global_variables.h"
 #include "entity.h"
 #include "io.h"
+#include "branch.h"
 
 cxxopts::Options options("tricl", "a generic network-based social simulation model");  ///< Holds all command line options
 
 // scalar parameters and their default values:
 unordered_map<relationship_or_action_type, string> gexf_filename = {};
+unordered_map<string, string> gexf_compression = {};
+string config_yaml_filename;  // filename of configuration file
 string diagram_fileprefix = "", gexf_default_filename = "";
+string tlog_filename = "", metrics_filename = "", profile_filename = "", snapshot_filename = "", resume_filename = "", branch_label = "", child_label = "";
+int branch_no = 0;
+unordered_map<string, string> branch_metaparameters = {};
+timepoint snapshot_dt = INFINITY;
+timepoint metrics_dt = INFINITY;
+long int metrics_n_events = LONG_MAX;
+long int snapshot_n_events = LONG_MAX;
 bool silent = false, verbose = false, quiet = false, debug = false, only_output_logl = false;
-timepoint max_t = 0.0;
+timepoint max_t = INFINITY;
 long int max_n_events = LONG_MAX;
+double max_wall_seconds = INFINITY, max_rss_mb = INFINITY;
 unsigned seed = 0;
+unsigned long replicate = 0, n_replicates = 1;
+unsigned n_threads = 1;
+double progress_seconds = 1.0;
+long int progress_n_events = LONG_MAX;
 
 // maps and sets of parameters with some defaults:
 unordered_map<entity_type, label> et2label = {};
@@ -38,12 +54,13 @@ unordered_map<relationship_or_action_type, bool> r_is_action_type = {};
 unordered_map<relationship_or_action_type, relationship_or_action_type> rat2inv = {};
 unordered_map<entity, label> e2label = {};
 unordered_map<string, entity> label2e = {};
-set<tricllink> initial_links = {};
+vector<tricllink> initial_links = {};
 unordered_map<entity_type, int> et2n_blocks = {};
 unordered_map<link_type, probability> lt2initial_prob_within = {};
 unordered_map<link_type, probability> lt2initial_prob_between = {};
 unordered_map<entity_type, int> et2dim = {};
 unordered_map<link_type, probability> lt2spatial_decay = {};
+unordered_map<link_type, probability> lt2spatial_tolerance = {};
 
 unordered_map<event_type, rate> evt2base_attempt_rate = {};
 unordered_map<influence_type, rate> inflt2attempt_rate = {};
@@ -73,6 +90,11 @@ int n_te_vars = 0;                   // total no. of these
 // convert a string expression into a double value:
 double parse_double (string expr)
 {
+    // YAML's spellings of infinity, which tinyexpr does not know:
+    auto first = expr.find_first_not_of(" \t"), last = expr.find_last_not_of(" \t");
+    auto s = (first == string::npos) ? "" : expr.substr(first, last - first + 1);
+    if ((s == ".inf") || (s == ".Inf") || (s == ".INF") || (s == "+.inf") || (s == "+.Inf") || (s == "+.INF")) return INFINITY;
+    if ((s == "-.inf") || (s == "-.Inf") || (s == "-.INF")) return -INFINITY;
     return te_eval(te_compile(expr.c_str(), te_vars, n_te_vars, 0));
 }
 
@@ -138,6 +160,18 @@ void read_config (
                     (n && n["debug"]) ? n["debug"].as<string>() : "false"))
             ("seed", "random seed", cxxopts::value<unsigned>()->default_value(
                     (n && n["seed"]) ? n["seed"].as<string>() : "0"))
+            ("replicate", "replicate no. (selects an independent random stream for the same seed)", cxxopts::value<unsigned long>()->default_value(
+                    (n && n["replicate"]) ? n["replicate"].as<string>() : "0"))
+            ("replicates", "no. of replicates (numbered replicate, replicate+1, ...) to run in parallel processes from the same initial state", cxxopts::value<unsigned long>()->default_value(
+                    (n && n["replicates"]) ? n["replicates"].as<string>() : "1"))
+            ("threads", "no. of threads used for initialization and parallel gzip, and of parallel branch or replicate processes (0: all hardware threads)", cxxopts::value<unsigned>()->default_value(
+                    (n && n["threads"]) ? n["threads"].as<string>() : "0"))
+            ("progress", "wall time between progress lines in seconds", cxxopts::value<double>()->default_value(
+                    (n && n["progress"]) ? n["progress"].as<string>() : "1"))
+            ("progress-events", "no. of events between progress lines (0: only by wall time)", cxxopts::value<long int>()->default_value(
+                    (n && n["progress-events"]) ? n["progress-events"].as<string>() : "0"))
+            ("resume", "resume from snapshot file", cxxopts::value<string>()->default_value(""))
+            ("branch", "only run this branch (default: run all branches)", cxxopts::value<string>()->default_value(""))
             ("logl", "log-likelihood estimation mode", cxxopts::value<bool>())
 //            ("grad", "output gradient of log-likelihood", cxxopts::value<bool>())
 //            ("events", "input csv file with events", cxxopts::value<string>())
@@ -173,6 +207,41 @@ void read_config (
     quiet = (cmdlineopts["quiet"].as<bool>() || silent) && (!debug);
     verbose = (cmdlineopts["verbose"].as<bool>() || debug) && (!quiet);
     seed = cmdlineopts["seed"].as<unsigned>();
+    replicate = cmdlineopts["replicate"].as<unsigned long>();
+    n_replicates = cmdlineopts["replicates"].as<unsigned long>();
+    if (n_replicates < 1) throw "option replicates must be positive";
+    n_threads = cmdlineopts["threads"].as<unsigned>();
+    if (n_threads == 0) n_threads = max(1u, std::thread::hardware_concurrency());
+    // debug output is not thread-safe:
+    if (debug) n_threads = 1;
+    progress_seconds = cmdlineopts["progress"].as<double>();
+    progress_n_events = cmdlineopts["progress-events"].as<long int>();
+    if (!(progress_seconds > 0) || (progress_n_events < 0)) throw "options progress and progress-events must be positive";
+    if (progress_n_events == 0) progress_n_events = LONG_MAX;
+    resume_filename = cmdlineopts["resume"].as<string>();
+    branch_label = cmdlineopts["branch"].as<string>();
+
+    // branches (from here on, each branch is run in its own process):
+    // (fresh const nodes since assigning to a used node would alter the node it refers to)
+    const YAML::Node branches = c["branches"], metaparameters = c["metaparameters"];
+    if (branches) {
+        if (!branches.IsMap()) throw "yaml field 'branches' must be a map";
+        if (n_replicates > 1) throw "branches cannot be combined with option replicates";
+        if (resume_filename == "") throw "branches require option --resume";
+        vector<string> labels;
+        for (YAML::const_iterator it = branches.begin(); it != branches.end(); ++it) labels.push_back(it->first.as<string>());
+        branch_no = select_branch(labels);
+        const YAML::Node overrides = branches[branch_label];
+        if (overrides && !overrides.IsNull()) {
+            if (!overrides.IsMap()) throw "branches must be maps of metaparameters to values or expressions";
+            for (YAML::const_iterator it = overrides.begin(); it != overrides.end(); ++it) {
+                auto symbol = it->first.as<string>();
+                if (!metaparameters || !metaparameters[symbol]) throw "branch overrides an undeclared metaparameter";
+                branch_metaparameters[symbol] = it->second.as<string>();
+            }
+        }
+        if (!quiet) cout << "BRANCH " << branch_label << endl;
+    } else if (branch_label != "") throw "option --branch requires a yaml field 'branches'";
 
     // read config file:
 
@@ -197,7 +266,8 @@ void read_config (
         if (!quiet) cout << " metaparameters:" << endl;
         for (YAML::const_iterator it = n.begin(); it != n.end(); ++it) {
             auto symbol = it->first.as<string>();
-            auto expression = cmdlineopts[symbol].as<string>();  // this is either the expression from the command line, or if missing then the one from the config file
+            // this is either the branch's expression, or the one from the command line, or if missing then the one from the config file:
+            auto expression = (branch_metaparameters.count(symbol) > 0) ? branch_metaparameters.at(symbol) : cmdlineopts[symbol].as<string>();
             double value = register_te_var(symbol, expression);
             if (!quiet) cout << "  " << symbol << " = " << expression << " = " << value << endl;
         }
@@ -219,20 +289,64 @@ void read_config (
         if (n["gexf"]) gexf_default_filename = n["gexf"].as<string>();
         // log_filename = n["log"].as<string>();
         if (n["diagram prefix"]) diagram_fileprefix = n["diagram prefix"].as<string>();
+        if (n["tlog"]) tlog_filename = n["tlog"].as<string>();
+        if (n["metrics"]) metrics_filename = n["metrics"].as<string>();
+        if (n["profile"]) {
+#ifdef TRICL_PROFILE
+            profile_filename = n["profile"].as<string>();
+#else
+            throw "files:profile requires tricl to be built with cmake option -DTRICL_PROFILE=ON";
+#endif
+        }
+        if (n["snapshot"]) snapshot_filename = n["snapshot"].as<string>();
+        if (n["compression"]) {
+            const YAML::Node nc = n["compression"];
+            if (!nc.IsMap()) throw "yaml field 'files:compression' must be a map";
+            for (YAML::const_iterator it = nc.begin(); it != nc.end(); ++it) {
+                auto fn = (it->first).as<string>(), cm = (it->second).as<string>();
+                if ((cm != "gzip") && (cm != "parallel gzip")) throw "files:compression values must be 'gzip' or 'parallel gzip'";
+                if ((fn.size() < 8) || (fn.substr(fn.size() - 8) != ".gexf.gz")) throw "files:compression keys must be names of .gexf.gz files";
+                gexf_compression[fn] = cm;
+            }
+        }
+    }
+
+    // snapshots:
+    n = c["snapshots"];
+    if (n) {
+        if (!n.IsMap()) throw "yaml field 'snapshots' must be a map";
+        if (snapshot_filename == "") throw "snapshots require a snapshot file name in files:snapshot";
+        if (n["t"]) snapshot_dt = parse_double(n["t"].as<string>());
+        if (n["events"]) snapshot_n_events = floor(parse_double(n["events"].as<string>()));
+        if (!(snapshot_dt > 0) || !(snapshot_n_events > 0)) throw "snapshots:t and snapshots:events must be positive";
     }
 
     // limits (at least one):
     n = c["limits"];
     if (!n.IsMap()) throw "yaml field 'limits' must be a map";
-    if (n["t"]) {
-        max_t = parse_double(n["t"].as<string>());
-        if (max_t == INFINITY) throw "limit: t must be finite";
-    }
+    if (n["t"]) max_t = parse_double(n["t"].as<string>());
+    if (!(max_t > 0)) throw "limits:t must be positive";
     if (n["events"]) max_n_events = floor(parse_double(n["events"].as<string>()));
-    // max_wall_time = n["wall"] ? n["wall"].as<double>() : INFINITY;  // TODO: support this option
+    if (n["wall"]) max_wall_seconds = parse_double(n["wall"].as<string>());
+    if (n["rss"]) max_rss_mb = parse_double(n["rss"].as<string>());
+    if (!(max_wall_seconds > 0) || !(max_rss_mb > 0)) throw "limits:wall and limits:rss must be positive";
     if ((max_t==INFINITY) && (max_n_events==LONG_MAX)) throw
             "must specify at least one of limits:t, limits:events";
 
+    // metrics:
+    n = c["metrics"];
+    if (n) {
+        if (!n.IsMap()) throw "yaml field 'metrics' must be a map";
+        if (metrics_filename == "") throw "metrics require a file name in files:metrics";
+        if (n["t"]) metrics_dt = parse_double(n["t"].as<string>());
+        if (n["events"]) metrics_n_events = floor(parse_double(n["events"].as<string>()));
+        if (!(metrics_dt > 0) || !(metrics_n_events > 0)) throw "metrics:t and metrics:events must be positive";
+    } else if (metrics_filename != "") {
+        // default: about 1000 rows per run
+        if (max_t < INFINITY) metrics_dt = max_t / 1000;
+        else metrics_n_events = max(1L, max_n_events / 1000);
+    }
+
     // entities:
     entity_type et = 1;
     n1 = c["entities"];
@@ -383,7 +497,7 @@ void read_config (
             try {
                 auto e1 = label2e.at(e1label), e3 = label2e.at(e3label);
                 auto rat13 = label2rat.at(rat13label);
-                initial_links.insert({ e1, rat13, e3 });
+                initial_links.push_back({ e1, rat13, e3 });
                 if (r_is_action_type[rat13]) {
 //                float impact = (*it)[3].as<double>(); // TODO: use!!
                 }
@@ -441,10 +555,13 @@ void read_config (
                     int dim = parse_int(spec["dimension"].as<string>());
                     // TODO: allow list of "widths"
                     auto dec = spec["decay"] ? parse_double(spec["decay"].as<string>()) : 1.0;
+                    auto tol = spec["tolerance"] ? parse_double(spec["tolerance"].as<string>()) : 0.0;
                     if (!(dim > 0)) throw "'dimension' must be positive";
                     if (!(dec > 0.0)) throw "'decay' must be positive";
+                    if (!((0.0 <= tol) && (tol < 1.0))) throw "'tolerance' must be at least 0.0 and below 1.0";
                     et2dim[et1] = et2dim[et3] = dim;
                     lt2spatial_decay[{et1, rat, et3}] = dec;
+                    lt2spatial_tolerance[{et1, rat, et3}] = tol;
                 }
             } catch (const std::exception&) {
                 throw "some entity or the relationship or action type was not declared";
@@ -459,7 +576,8 @@ void read_config (
         for (YAML::const_iterator it1 = n1.begin(); it1 != n1.end(); ++it1) {
             auto key = (it1->first).as<string>();
             auto n2 = it1->second;
-            if ((key != "named") && (key != "random")) {
+            // (when resuming, all entities and links are restored from the snapshot instead)
+            if ((key != "named") && (key != "random") && (resume_filename == "")) {
                 auto filename = key;
                 if (verbose) cout << " reading initial links from file " << filename << " ..." << endl;
                 auto ext = filename.substr(filename.find_last_of(".") + 1);
@@ -500,7 +618,7 @@ void read_config (
                     if (n2["prefix"]) {
                         if (n2["prefix"].IsSequence()) {
                             e1_prefix = n2["prefix"][0].as<string>();
-                            e3_prefix = n2["prefix"][0].as<string>();
+                            e3_prefix = n2["prefix"][1].as<string>();
                         } else {
                             e1_prefix = e3_prefix = n2["prefix"].as<string>();
                         }
@@ -0,0 +1,248 @@
+/** tricl_convert, a converter from tricl's binary event log (.tlog) to gexf or csv
+ *
+ *  \file
+ *
+ *  Usage: ``tricl_convert input.tlog output.gexf|output.gexf.gz|output.csv|output.csv.gz``
+ *
+ *  - csv output has one row per establishment or termination of a link,
+ *    with columns t, event ("establish" or "terminate"), source, relationship or action type, target (as labels).
+ *  - gexf output has one node per entity and one edge per time interval at which a link existed,
+ *    with the same attributes as tricl's own gexf output (but without visualization information).
+ *
+ *  See \ref tlog_format.h for the input format.
+ */
+
+#include <fcntl.h>
+#include <math.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <zlib.h>
+#include <iostream>
+#include <map>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include "tlog_format.h"
+#include "io.h"
+
+using std::string;
+using std::vector;
+using std::unordered_map;
+using std::map;
+using std::tuple;
+using std::cout;
+using std::cerr;
+using std::endl;
+
+/** Output to a plain or gzip-compressed file, buffered in large chunks.
+ */
+struct output_file
+{
+    FILE* plain = NULL;
+    gzFile gz = NULL;
+    string buf;
+
+    output_file (const string& filename, bool is_gz)
+    {
+        if (is_gz) gz = gzopen(filename.c_str(), "wb");
+        else plain = fopen(filename.c_str(), "wb");
+        if ((gz == NULL) && (plain == NULL)) throw "cannot write output file";
+    }
+    void flush ()
+    {
+        if (!buf.empty()) {
+            if ((gz != NULL) ? (gzwrite(gz, buf.data(), buf.size()) == 0)
+                    : (fwrite(buf.data(), 1, buf.size(), plain) != buf.size())) throw "cannot write output file (disk full?)";
+        }
+        buf.clear();
+    }
+    output_file& operator<< (const string& s)
+    {
+        buf += s;
+        if (buf.size() >= (1<<24)) flush();
+        return *this;
+    }
+    void close ()
+    {
+        flush();
+        if ((gz != NULL) ? (gzclose(gz) != Z_OK) : (fclose(plain) != 0)) throw "cannot write output file (disk full?)";
+    }
+};
+
+/** \returns shortest exact decimal representation of t
+ */
+string time_string (double t)
+{
+    char s[32];
+    snprintf(s, sizeof(s), "%.17g", t);
+    return s;
+}
+
+/** \returns s with the characters special in xml replaced by entities
+ */
+string xml_escaped (const string& s)
+{
+    string r;
+    for (char c : s) {
+        if (c == '&') r += "&amp;";
+        else if (c == '<') r += "&lt;";
+        else if (c == '>') r += "&gt;";
+        else if (c == '"') r += "&quot;";
+        else r += c;
+    }
+    return r;
+}
+
+int main (int argc, char *argv[])
+{
+    try
+    {
+        if (argc != 3) {
+            cout << "Usage:  tricl_convert input.tlog output.gexf|output.gexf.gz|output.csv|output.csv.gz" << endl;
+            return 1;
+        }
+        string in_filename = argv[1], out_filename = argv[2];
+        bool is_gz = (out_filename.size() > 3) && (out_filename.substr(out_filename.size() - 3) == ".gz");
+        string stem = is_gz ? out_filename.substr(0, out_filename.size() - 3) : out_filename;
+        bool is_csv = (stem.size() > 4) && (stem.substr(stem.size() - 4) == ".csv");
+        bool is_gexf = (stem.size() > 5) && (stem.substr(stem.size() - 5) == ".gexf");
+        if (!is_csv && !is_gexf) throw "output file must end with .gexf, .gexf.gz, .csv or .csv.gz";
+
+        // map input file:
+        int fd = open(in_filename.c_str(), O_RDONLY);
+        if (fd == -1) throw "cannot open tlog file";
+        struct stat st;
+        if (fstat(fd, &st) == -1) { close(fd); throw "cannot open tlog file"; }
+        size_t size = st.st_size;
+        if (size < 20) { close(fd); throw "not a tricl tlog file"; }
+        auto data = (const char*) mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (data == MAP_FAILED) throw "cannot map tlog file";
+        const char *p = data, *end = data + size;
+
+        // header:
+        if (memcmp(p, tlog_magic, 8) != 0) throw "not a tricl tlog file";
+        uint32_t version;
+        memcpy(&version, p + 8, 4);
+        if (version != TLOG_VERSION) throw "unsupported tlog version";
+        double max_t;
+        memcpy(&max_t, p + 12, 8);
+        p += 20;
+        map<uint64_t, string> et2label, rat2label;
+        auto n_ets = tlog_get_varint(p, end);
+        for (uint64_t i = 0; i < n_ets; i++) {
+            auto et = tlog_get_varint(p, end);
+            et2label[et] = tlog_get_string(p, end);
+        }
+        auto n_rats = tlog_get_varint(p, end);
+        for (uint64_t i = 0; i < n_rats; i++) {
+            auto rat = tlog_get_varint(p, end);
+            tlog_get_varint(p, end);  // inverse (not needed here)
+            rat2label[rat] = tlog_get_string(p, end);
+        }
+        auto max_e = tlog_get_varint(p, end);
+        vector<uint64_t> e2et(max_e + 1);
+        vector<string> e2label(max_e + 1);
+        for (uint64_t e = 1; e <= max_e; e++) {
+            e2et[e] = tlog_get_varint(p, end);
+            e2label[e] = tlog_get_string(p, end);
+        }
+
+        output_file out(out_filename, is_gz);
+        if (is_csv) {
+            out << "t,event,source,relationship or action type,target\n";
+        } else {
+            out << R"V0G0N(<?xml version="1.0" encoding="UTF-8"?>
+<gexf xmlns="http://www.gexf.net/1.2draft" version="1.2"><meta><creator>tricl_convert</creator><description>dynamic graph generated by tricl model</description></meta><graph mode="dynamic" defaultedgetype="directed"><attributes class="node"><attribute id="T" title="entity type" type="string"/></attributes><attributes class="edge"><attribute id="R" title="relationship or action type" type="string"/><attribute id="S" title="start" type="float"/><attribute id="E" title="end" type="float"/></attributes><nodes>)V0G0N";
+            for (uint64_t e = 1; e <= max_e; e++) {
+                out << "<node id=\"" + std::to_string(e) + "\" label=\"" + xml_escaped(e2label[e])
+                        + "\" start=\"0.0\"" + ((max_t < INFINITY) ? " end=\"" + time_string(max_t) + "\"" : "")
+                        + "><attvalues><attvalue for=\"T\" value=\"" + xml_escaped(et2label[e2et[e]]) + "\"/></attvalues></node>";
+            }
+            out << "</nodes><edges>\n";
+        }
+
+        // records:
+        map<tuple<uint64_t, uint64_t, uint64_t>, double> link2start;  // (ordered so that surviving links are output deterministically)
+        uint64_t n_records_total = 0;
+        auto output_edge = [&](uint64_t e1, uint64_t rat13, uint64_t e3, double start, double end_t, uint64_t id) {
+            string s_start = time_string(start), s_end = time_string(end_t);
+            // (with the same comment key as in tricl's gexf files, so that tricl_mergelinks can process them:)
+            string key = std::to_string(e1) + "_" + std::to_string(rat13) + "_" + std::to_string(e3) + "_" + std::to_string(id);
+            out << "<!--" + key + "--> <edge id=\"" + key
+                    + "\" source=\"" + std::to_string(e1) + "\" target=\"" + std::to_string(e3)
+                    + "\" start=\"" + s_start + "\" end=\"" + s_end
+                    + "\"><attvalues><attvalue for=\"R\" value=\"" + xml_escaped(rat2label[rat13])
+                    + "\"/><attvalue for=\"S\" value=\"" + s_start
+                    + "\"/><attvalue for=\"E\" value=\"" + s_end + "\"/></attvalues></edge>\n";
+        };
+        vector<uint64_t> codes, e1s, e3s;
+        bool complete = false;
+        double last_t = 0;
+        string payload;
+        while (end - p >= 12) {
+            uint32_t sizes[3];  // compressed size, no. of records, uncompressed size
+            memcpy(sizes, p, 12);
+            p += 12;
+            uint32_t n = sizes[1];
+            if (n == 0) {
+                complete = true;
+                break;
+            }
+            if (sizes[0] > (uint64_t) (end - p)) throw "tlog file is truncated or corrupt";
+            const char* next_block = p + sizes[0];
+            payload.resize(sizes[2]);
+            uLongf payload_size = sizes[2];
+            if ((uncompress((Bytef*) payload.data(), &payload_size, (const Bytef*) p, sizes[0]) != Z_OK)
+                    || (payload_size != sizes[2])) throw "tlog file is truncated or corrupt";
+            p = payload.data();
+            const char* block_end = p + payload_size;
+            codes.resize(n); e1s.resize(n); e3s.resize(n);
+            for (auto& x : codes) x = tlog_get_varint(p, block_end);
+            for (auto& x : e1s) x = tlog_get_varint(p, block_end);
+            for (auto& x : e3s) x = tlog_get_varint(p, block_end);
+            uint64_t t_bits = 0;
+            for (uint32_t i = 0; i < n; i++) {
+                t_bits ^= tlog_get_varint(p, block_end);
+                double t = last_t = tlog_bits_time(t_bits);
+                uint64_t rat13 = codes[i] >> 1, e1 = e1s[i], e3 = e3s[i];
+                bool is_termination = codes[i] & 1;
+                if ((e1 > max_e) || (e3 > max_e)) throw "tlog file is truncated or corrupt";
+                if (is_csv) {
+                    out << time_string(t) + (is_termination ? ",terminate," : ",establish,") + csv_quoted(e2label[e1])
+                            + "," + csv_quoted(rat2label[rat13]) + "," + csv_quoted(e2label[e3]) + "\n";
+                } else if (is_termination) {
+                    auto it = link2start.find({ e1, rat13, e3 });
+                    if (it == link2start.end()) throw "tlog file contains termination of a nonexistent link";
+                    output_edge(e1, rat13, e3, it->second, t, n_records_total + i);
+                    link2start.erase(it);
+                } else {
+                    link2start[{ e1, rat13, e3 }] = t;
+                }
+            }
+            n_records_total += n;
+            p = next_block;
+        }
+        if (!complete) cerr << "WARNING: tlog file has no end marker (was the run interrupted?)" << endl;
+
+        if (is_gexf) {
+            // edges of links surviving until the end (or until the last event if there was no limits:t):
+            for (auto& [l, start] : link2start) {
+                output_edge(std::get<0>(l), std::get<1>(l), std::get<2>(l), start, (max_t < INFINITY) ? max_t : last_t, n_records_total);
+            }
+            out << "<!--Z--> </edges></graph></gexf>\n";
+        }
+        out.close();
+        munmap((void*) data, size);
+        cout << n_records_total << " records converted." << endl;
+    }
+    catch (const char* msg)
+    {
+        cerr << "ERROR: exiting with message: " << msg << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -61,6 +61,7 @@
 
 // other:
 #include <math.h>
+#include <algorithm>
 
 
 /// We use our own namespace to avoid clashes with 3rdparty names, e.g. "link"
@@ -82,6 +83,8 @@ using std::unordered_map;
 using std::map;
 using std::max;
 using std::min;
+using std::sort;
+using std::unique;
 using std::round;
 
 
@@ -298,6 +301,7 @@ struct outleg
     // in contrast to the other structs, here the members cannot be const since outlegs are used as values of flat_sets:
     relationship_or_action_type rat_out;  ///< Plays a similar role as \c rat12 in an angle.
     entity e_target;                      ///< Target entity of the leg. Plays a similar role as \c e2 in an angle.
+    timepoint t_start = 0;                ///< Time at which the link was established, for output (not part of the leg's identity)
 
     friend bool operator== (const outleg& left, const outleg& right) {
         return (left.e_target == right.e_target
@@ -9,6 +9,7 @@
 #include "global_variables.h"
 #include "angle.h"
 #include "io.h"
+#include "summary.h"
 
 /** Compute total finite event rate from scratch
  *  in order to compare it with the stored one
@@ -136,4 +137,6 @@ void verify_data_consistency () {
         assert (t > -INFINITY);
         assert (ev2data.count(ev) == 1);
     }
+    // summary event samplers:
+    verify_summary_samplers();
 }
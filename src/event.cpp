@@ -16,20 +16,94 @@
 #include "io.h"
 #include "debugging.h"
 #include "schedule.h"
+#include "metrics.h"
 
 #include "event.h"
 
-/** Add (and then schedule) an event.
+event_data current_evd;  ///< Copy of the data of the current event, which \ref current_evd_ points to after \ref pop_next_event()
+
+/** Compile the data of an event from the current network state.
  *
- *  To determine the effective rate of the event, all influencing angles
- *  must be identified.
+ *  To determine the attempt rate and success probability units of the event,
+ *  all influencing legs and angles must be identified.
+ *  Only reads the network state, so it may be called for many events in any order.
  *
  *  This is a performance-critical function, using a large share of the model's CPU time.
+ *
+ *  \returns the event data with n_angles, attempt_rate and success_probunits set, not yet scheduled (t=-inf)
+ */
+event_data compile_event_data (
+        const event& ev,          ///< [in] the event, whose type must be possible
+        const outleg_set& outs1,  ///< [in] current outlegs of its source entity
+        const inleg_set& ins3     ///< [in] current inlegs of its target entity
+        )
+{
+    auto ec = ev.ec; auto e1 = ev.e1, e3 = ev.e3; auto rat13 = ev.rat13;
+    auto et1 = e2et[e1], et3 = e2et[e3];
+    event_type evt = { .ec=ec, et1, rat13, et3 };
+
+    // base values:
+    rate ar = evt2base_attempt_rate.at(evt);
+    probunits spu = evt2base_probunits.at(evt);
+
+    // outlegs:
+    for (auto& l : outs1) {
+        auto rat12 = l.rat_out;
+        auto e2 = l.e_target;
+        influence_type inflt = { .evt = evt, .at = { .rat12 = rat12, .et2 = e2et[e2], .rat23 = NO_RAT } };
+        ar += _inflt2attempt_rate[INFLT(inflt)];
+        spu += _inflt2delta_probunits[INFLT(inflt)];
+    }
+
+    // inlegs (similarly):
+    for (auto& l : ins3) {
+        auto e2 = l.e_source;
+        auto rat23 = l.rat_in;
+        influence_type inflt = { .evt = evt, .at = { .rat12 = NO_RAT, .et2 = e2et[e2], .rat23 = rat23 } };
+        ar += _inflt2attempt_rate[INFLT(inflt)];
+        spu += _inflt2delta_probunits[INFLT(inflt)];
+    }
+
+    // angles:
+    int na = 0; // number of influencing angles
+    angle_vec angles = get_angles(e1, outs1, ins3, e3);
+    for (auto a_it = angles.begin(); a_it != angles.end(); a_it++) {
+        influence_type inflt = {
+                .evt = evt,
+                .at = { .rat12 = a_it->rat12, .et2 = e2et[a_it->e2], .rat23 = a_it->rat23 }
+        };
+        if (debug) cout << "      influences of angle \"" << e2label[e1] << " " << rat2label[a_it->rat12] << " " << e2label[a_it->e2] << " " << rat2label[a_it->rat23] << " " << e2label[e3] << "\":" << endl;
+
+        // get influence of angle on event:
+        auto dar = _inflt2attempt_rate[INFLT(inflt)];
+        auto dspu = _inflt2delta_probunits[INFLT(inflt)];
+        if (COUNT_ALL_ANGLES || (dar != 0.0) || (dspu != 0.0)) { // angle can influence event
+            // count this angle:
+            na++;
+            if (debug) {
+                if (dar != 0.0) cout << "       on attempt rate:" << dar << endl;
+                if (dspu != 0.0) cout << "       on success probunit:" << dspu << endl;
+            }
+            // add its influence:
+            ar += dar;
+            spu += dspu;
+        }
+        else if (debug) cout << "       none" << endl;
+    }
+
+    return { .n_angles = na, .attempt_rate = max(0.0, ar), .success_probunits = spu, .effective_rate = 0, .t = -INFINITY };
+}
+
+/** Add (and then schedule) an event.
+ *
+ *  To determine the effective rate of the event, all influencing angles
+ *  must be identified, see \ref compile_event_data().
  */
 void add_event (
         event& ev  ///< [in] the event to be added
         )
 {
+    PROFILE_SCOPE(PROF_ADD_EVENT);
     auto ec = ev.ec; auto e1 = ev.e1, e3 = ev.e3; auto rat13 = ev.rat13;
     auto et1 = e2et[e1], et3 = e2et[e3];
     event_type evt = { .ec=ec, et1, rat13, et3 };
@@ -42,66 +116,19 @@ void add_event (
 
         if (debug) cout << "     adding event: " << ev << endl;
 
-        // base values:
-        rate ar = evt2base_attempt_rate[evt];
-        probunits spu = evt2base_probunits[evt];
-
-        // outlegs:
-        auto outs1 = e2outs[e1];
-        for (auto& l : outs1) {
-            auto rat12 = l.rat_out;
-            auto e2 = l.e_target;
-            influence_type inflt = { .evt = evt, .at = { .rat12 = rat12, .et2 = e2et[e2], .rat23 = NO_RAT } };
-            ar += _inflt2attempt_rate[INFLT(inflt)];
-            spu += _inflt2delta_probunits[INFLT(inflt)];
-        }
-
-        // inlegs (similarly):
-        auto ins3 = e2ins[e3];
-        for (auto& l : ins3) {
-            auto e2 = l.e_source;
-            auto rat23 = l.rat_in;
-            influence_type inflt = { .evt = evt, .at = { .rat12 = NO_RAT, .et2 = e2et[e2], .rat23 = rat23 } };
-            ar += _inflt2attempt_rate[INFLT(inflt)];
-            spu += _inflt2delta_probunits[INFLT(inflt)];
-        }
-
-        // angles:
-        int na = 0; // number of influencing angles
-        angle_vec angles = get_angles(e1, outs1, ins3, e3);
-        for (auto a_it = angles.begin(); a_it != angles.end(); a_it++) {
-            influence_type inflt = {
-                    .evt = evt,
-                    .at = { .rat12 = a_it->rat12, .et2 = e2et[a_it->e2], .rat23 = a_it->rat23 }
-            };
-            if (debug) cout << "      influences of angle \"" << e2label[e1] << " " << rat2label[a_it->rat12] << " " << e2label[a_it->e2] << " " << rat2label[a_it->rat23] << " " << e2label[e3] << "\":" << endl;
-
-            // get influence of angle on event:
-            auto dar = _inflt2attempt_rate[INFLT(inflt)];
-            auto dspu = _inflt2delta_probunits[INFLT(inflt)];
-            if (COUNT_ALL_ANGLES || (dar != 0.0) || (dspu != 0.0)) { // angle can influence event
-                // count this angle:
-                na++;
-                if (debug) {
-                    if (dar != 0.0) cout << "       on attempt rate:" << dar << endl;
-                    if (dspu != 0.0) cout << "       on success probunit:" << dspu << endl;
-                }
-                // add its influence:
-                ar += dar;
-                spu += dspu;
-            }
-            else if (debug) cout << "       none" << endl;
-        }
+        auto evd = compile_event_data(ev, e2outs.at(e1), e2ins.at(e3));
+        PROFILE_EVT(evt, compiled, 1);
+        PROFILE_EVT(evt, compiled_angles, evd.n_angles);
 
         // add and schedule:
         // (a non-termination event is only added and scheduled individually if at least one angle influences it
         // -- non-termination events without influences are handled via summary events to keep maps sparse):
-        if ((ec == EC_TERM) || (na > 0)) {
+        if ((ec == EC_TERM) || (evd.n_angles > 0)) {
             assert (ev2data.count(ev) == 0);
 
             // register its data, at first with t=-inf (will be set upon scheduling):
-            ev2data[ev] = { .n_angles = na, .attempt_rate = max(0.0, ar), .success_probunits = spu, .t = -INFINITY };
-            if (debug) cout << "      attempt rate " << ar << ", success prob. " << probunits2probability(spu, evt2left_tail.at(evt), evt2right_tail.at(evt)) << endl;
+            ev2data[ev] = evd;
+            if (debug) cout << "      attempt rate " << evd.attempt_rate << ", success prob. " << probunits2probability(evd.success_probunits, evt2left_tail.at(evt), evt2right_tail.at(evt)) << endl;
             // now schedule it:
             schedule_event(ev, &ev2data[ev], evt2left_tail.at(evt), evt2right_tail.at(evt));
 
@@ -125,12 +152,13 @@ void remove_event (
 {
     assert (event_is_scheduled(ev, evd_));
 
-    // keep t2ev and ev2data consistent:
-    t2ev.erase(evd_->t); ev2data.erase(ev);
-
     subtract_effective_rate(evd_->effective_rate);
+    if ((ev.ec == EC_EST) && !event_is_summary(ev)) change_summary_coverage(ev.e1, ev.rat13, ev.e3, 1);
 
     if (debug) cout << "        removed event: " << ev << " scheduled at " << evd_->t << endl;
+
+    // keep t2ev and ev2data consistent (erasing from ev2data must come last since evd_ points into it):
+    t2ev.erase(evd_->t); ev2data.erase(ev);
 }
 
 /** Remove event if scheduled and adjust total effective rate (!).
@@ -234,6 +262,10 @@ void perform_event (
     auto ec = ev.ec; auto e1 = ev.e1, e3 = ev.e3; auto rat13 = ev.rat13, rat31 = rat2inv.at(rat13);
     assert (rat13 != RT_ID);
     tricllink l = { e1, rat13, e3 };
+#ifdef TRICL_PROFILE
+    event_type evt = { .ec = ec, e2et[e1], rat13, e2et[e3] };
+    auto n_angle_changes_before = profile_counters[PROF_ADD_OR_DELETE_ANGLE].calls;
+#endif
 
     // compute and store log-likelihood of next event happening at current_t and being current_t:
     rate er = evd_->effective_rate,
@@ -244,6 +276,7 @@ void perform_event (
             : -last_total_er * last_dt               // log probability density of next event occurring exactly at t
               + log(er) - log(last_total_er);        // + log probability of that event being this event
     cumulative_logl += logl;
+    last_dt = 0;  // (accumulated again in pop_next_event, also across snapshots)
     if (verbose) cout << "  log-likelihoods: this " << logl << ", total " << cumulative_logl << endl;
     if (debug) cout << "   total er " << total_finite_effective_rate << " + " << n_infinite_effective_rates << " * inf" << endl;
 
@@ -267,13 +300,9 @@ void perform_event (
         event companion_ev = { .ec = ec, .e1 = e3, .rat13 = rat31, .e3 = e1 };
         tricllink inv_l = { .e1 = e3, .rat13 = rat31, .e3 = e1 }; // inverse link
 
-        // if scheduled, unschedule it:
-        if (ev2data.count(companion_ev) == 1)
-        {
-            if (debug) cout << " unscheduling companion event: " << companion_ev << endl;
-            auto companion_evd_ = &ev2data.at(companion_ev);
-            remove_event(companion_ev, companion_evd_);
-        }
+        // if scheduled, unschedule it, otherwise it is no longer covered by a summary event:
+        if (debug) cout << " unscheduling companion event: " << companion_ev << endl;
+        conditionally_remove_event(companion_ev);
 
         // since companion event happens with probability one, it adds no log-likelihood
 
@@ -295,6 +324,10 @@ void perform_event (
         // FINALLY update all adjacent events (including the reverse event) to reflect the change:
         update_adjacent_events(companion_ev);
     }
+    PROFILE_EVT(evt, performed, 1);
+    PROFILE_EVT(evt, touched_angles, profile_counters[PROF_ADD_OR_DELETE_ANGLE].calls - n_angle_changes_before);
+    // the rates of summary events depend on their no. of covered pairs:
+    reschedule_changed_summary_events();
     if (debug)
     {
 //        dump_links();
@@ -312,6 +345,7 @@ void perform_event (
  */
 bool pop_next_event ()
 {
+    PROFILE_SCOPE(PROF_POP_NEXT_EVENT);
     // find next event:
     bool found = false;
     while ((!found) && (current_t < max_t))  // we may need several attempts to find an event that actually occurs...
@@ -321,15 +355,16 @@ bool pop_next_event ()
         auto tev_handle = t2ev.begin();
         if (tev_handle == t2ev.end())  // no events are scheduled --> model has converged
         {
-            log_state();
+            if (verbose) log_state();
             // jump to end of simulation:
+            if (max_t < INFINITY) last_dt += max_t - current_t;
             current_t = max_t;
             return false;
         }
 
         // get corresponding timepoint:
         timepoint t = tev_handle->first;
-        if (t >= max_t)  // no events before max_t are scheduled
+        if (t >= min(max_t, NEVER_T))  // no events before max_t are scheduled
         {
             if (!quiet)
             {
@@ -337,6 +372,7 @@ bool pop_next_event ()
                 else cout << "no further events are scheduled." << endl;
             }
             // jump to end:
+            if (max_t < INFINITY) last_dt += max_t - current_t;
             current_t = max_t;
             return false;
         }
@@ -346,13 +382,12 @@ bool pop_next_event ()
         if (t > current_t)  // event is not happening "right now"
         {
             // advance model time to time of event:
-            last_dt = t - current_t;
+            sample_metrics_before(t);
+            // (the time since the last event includes that of rejected summary event draws):
+            last_dt += t - current_t;
             current_t = t;
         }
-        else  // event is happening "right now" and was scheduled formally for a past time to ensure a random order of those events
-        {
-            last_dt = 0;
-        }
+        // else event is happening "right now" and was scheduled formally for a past time to ensure a random order of those events
 
         if (event_is_summary(ev))  // event is a summary event, so has only types specified and needs to be tested for success
         {
@@ -363,20 +398,44 @@ bool pop_next_event ()
             if (debug) cout << "at t=" << current_t << " summary event " << summary_ev << " :" << endl;
 
             entity_type et1 = summary_et1(summary_ev), et3 = summary_et3(summary_ev);
+            auto rat13 = summary_ev.rat13;
+            event_type evt = { .ec = EC_EST, et1, rat13, et3 };
 
-            // draw actual entities at random from given types:
-            auto e1 = random_entity(et1), e3 = random_entity(et3);
+            // since the summary event was scheduled at the rate of an upper bound to its no. of covered pairs,
+            // it is an attempt for one of them only with probability n_covered / bound:
+            auto s = summary_sampler_of(summary_ev);
+            if ((s != nullptr) && !(uniform(random_variable) * s->n_covered_bound < s->n_covered))
+            {
+                if (verbose) cout << "at t=" << current_t << ", summary event attempt was thinned out" << endl;
+                reschedule_event(summary_ev, &ev2data.at(summary_ev), evt2left_tail.at(evt), evt2right_tail.at(evt));
+                continue;
+            }
+
+            // draw actual entities at random from the pairs covered by the summary event
+            // (or from all pairs of the given types if its sampler is not initialized):
+            entity e1, e3;
+            if (s != nullptr) {
+                e1 = random_summary_source(*s);
+                e3 = random_summary_target(*s, e1);
+            } else {
+                e1 = random_entity(et1);
+                e3 = random_entity(et3);
+            }
 
-            auto rat13 = summary_ev.rat13;
             tricllink l = { e1, rat13, e3 };
-            event_type evt = { .ec = EC_EST, et1, rat13, et3 };
+            PROFILE_COUNT(PROF_SUMMARY_DRAW);
+            PROFILE_EVT(evt, summary_draws, 1);
 
             if (link_exists(l))
             {
+                PROFILE_COUNT(PROF_SUMMARY_REJECT_EXISTS);
+                PROFILE_EVT(evt, reject_exists, 1);
                 if (verbose) cout << "at t=" << current_t << ", link to establish \"" << e2label[e1] << " " << rat2label[rat13] << " " << e2label[e3] << "\" existed already" << endl;
             }
             else if (e1 == e3)
             {
+                PROFILE_COUNT(PROF_SUMMARY_REJECT_EQUAL);
+                PROFILE_EVT(evt, reject_equal, 1);
                 if (verbose) cout << "at t=" << current_t << ", entities to link were equal and are thus not linked" << endl;
             }
             else  // link can be established
@@ -385,6 +444,8 @@ bool pop_next_event ()
                 if (ev2data.count(actual_ev) > 0)  // the event was scheduled separately since it is influenced by at least one angle
                 {
                     // --> don't perform it now.
+                    PROFILE_COUNT(PROF_SUMMARY_REJECT_SEPARATE);
+                    PROFILE_EVT(evt, reject_separate, 1);
                     if (verbose) cout << "at t=" << current_t << " " << actual_ev << " is scheduled separately at t=" << ev2data.at(actual_ev).t << ", so not performed now." << endl;
                 }
                 else  // event not scheduled separately (but may still be influenced by legs!)
@@ -422,7 +483,7 @@ bool pop_next_event ()
                         rate actual_er = summary_evd.attempt_rate / et2n[et1] / et2n[et3]
                                          * success_probability;
                         // construct event data with proper effective rate for actual event:
-                        event_data actual_evd_ = {
+                        current_evd = {
                                 .n_angles = 0,  // unimportant, will not be used by perform_event
                                 .attempt_rate = INFINITY,  // unimportant, will not be used by perform_event
                                 .success_probunits = INFINITY,  // unimportant, will not be used by perform_event
@@ -431,8 +492,8 @@ bool pop_next_event ()
                         };
                         // register event as current event:
                         current_ev = actual_ev;
-                        current_evd_ = &actual_evd_;
-                        log_state();
+                        current_evd_ = &current_evd;
+                        if (verbose) log_state();
                         found = true;
                         // adjust effective rate because summary addition event does no longer cover this pair:
                         subtract_effective_rate(summary_evt2single_effective_rate.at(evt));
@@ -440,6 +501,8 @@ bool pop_next_event ()
                     }
                     else
                     {
+                        PROFILE_COUNT(PROF_SUMMARY_REJECT_FAILED);
+                        PROFILE_EVT(evt, reject_failed, 1);
                         if (verbose) cout << "at t=" << current_t << " " << actual_ev << " did not succeed" << endl;
                     }
                 }
@@ -451,8 +514,11 @@ bool pop_next_event ()
         {
             // register event as current event:
             current_ev = ev;
-            log_state();
-            auto evd_ = current_evd_ = &ev2data.at(ev);
+            if (verbose) log_state();
+            auto evd_ = &ev2data.at(ev);
+            // keep a copy of its data since remove_event will erase the original:
+            current_evd = *evd_;
+            current_evd_ = &current_evd;
             // remove it from all relevant data:
             remove_event(ev, evd_);
             found = true;
@@ -15,6 +15,10 @@
 #include "probability.h"
 #include "io.h"
 #include "debugging.h"
+#include "profile.h"
+#include "summary.h"
+
+#define NEVER_T 1e300  ///< Events with zero effective rate are scheduled after min(max_t, this), so that they are never performed
 
 inline bool event_is_summary(const event& ev) {
     // summary events are encoded by using the negative entity type id as "entity id":
@@ -34,6 +38,13 @@ inline entity_type summary_et3(const event& ev) {
     return (entity_type) -ev.e3;
 }
 
+/** \returns the type of a particular or summary event
+ */
+inline event_type get_event_type(const event& ev) {
+    if (event_is_summary(ev)) return { .ec = EC_EST, summary_et1(ev), ev.rat13, summary_et3(ev) };
+    return { .ec = ev.ec, e2et[ev.e1], ev.rat13, e2et[ev.e3] };
+}
+
 /** Return whether a future instance of the event is scheduled.
  */
 inline bool event_is_scheduled (
@@ -47,6 +58,7 @@ inline bool event_is_scheduled (
 
 inline void _schedule_event (event& ev, event_data* evd_, double left_tail, double right_tail)
 {
+    PROFILE_SCOPE(PROF_SCHEDULE_EVENT);
     assert(evd_ == &ev2data.at(ev));
     rate ar = evd_->attempt_rate;
     if (ar < 0.0) throw "negative attempt rate";
@@ -54,8 +66,15 @@ inline void _schedule_event (event& ev, event_data* evd_, double left_tail, doub
     timepoint t;
     if (event_is_summary(ev))  // summary event:
     {
-        // use a common upper bound to the actual effective rate for scheduling (actual success will then later be tested in pop_next_event):
-        t = current_t + exponential(random_variable) / (ar * summary_ev2max_success_probability[ev]);
+        // use a common upper bound to the actual effective rate of the covered pairs for scheduling
+        // (whether a covered pair is drawn and actual success will then later be tested in pop_next_event):
+        auto s = summary_sampler_of(ev);
+        double covered_share = 1.0;  // (before the samplers are initialized, all pairs are drawn from)
+        if (s != nullptr) {
+            s->n_covered_bound = summary_bound(s->n_covered);
+            covered_share = s->n_covered_bound / s->n_pairs;
+        }
+        t = current_t + next_exponential() / (ar * covered_share * summary_ev2max_success_probability[ev]);
         if (verbose) cout << "         (re)scheduling " << ev << ": summary event, attempt rate " << ar << " → attempt at t=" << t << ", test success then" << endl;
         // compute base effective rate using base success probability units:
         rate er = evd_->effective_rate = effective_rate(ar, spu, left_tail, right_tail);
@@ -82,7 +101,7 @@ inline void _schedule_event (event& ev, event_data* evd_, double left_tail, doub
             add_effective_rate(er);
 
             // draw time interval after which it would happen if nothing changes in between:
-            timepoint dt = exponential(random_variable) / er;
+            timepoint dt = next_exponential() / er;
             // add it to current time to get occurence time:
             t = current_t + dt;
 
@@ -107,7 +126,7 @@ inline void _schedule_event (event& ev, event_data* evd_, double left_tail, doub
     if (t == INFINITY)
     {
         // replace INFINITY by some unique finite but non-reached time point:
-        t = max_t * (1 + uniform(random_variable));
+        t = min(max_t, NEVER_T) * (1 + uniform(random_variable));
     }
     // store time:
     evd_->t = t;
@@ -119,6 +138,9 @@ inline void schedule_event (event& ev, event_data* evd_, double left_tail, doubl
     assert(evd_ == &ev2data.at(ev));
     if (event_is_scheduled(ev, evd_)) throw "event already scheduled";
     assert(!event_is_scheduled(ev, evd_));
+    PROFILE_EVT(get_event_type(ev), schedules, 1);
+    // a separately scheduled establishment event is no longer covered by its summary event:
+    if ((ev.ec == EC_EST) && !event_is_summary(ev)) change_summary_coverage(ev.e1, ev.rat13, ev.e3, -1);
     _schedule_event(ev, evd_, left_tail, right_tail);
     if (debug) verify_data_consistency();
 }
@@ -127,6 +149,7 @@ inline void reschedule_event (event& ev, event_data* evd_, double left_tail, dou
 {
     assert(evd_ == &ev2data.at(ev));
     assert(event_is_scheduled(ev, evd_));
+    PROFILE_EVT(get_event_type(ev), reschedules, 1);
 
     // remove from schedule and total_effective_rate:
     t2ev.erase(evd_->t);
@@ -137,6 +160,8 @@ inline void reschedule_event (event& ev, event_data* evd_, double left_tail, dou
     if (debug) verify_data_consistency();
 }
 
+event_data compile_event_data (const event& ev, const outleg_set& outs1, const inleg_set& ins3);
+
 void add_event (event& ev);
 
 void remove_event (event& ev, event_data* evd_);
@@ -7,14 +7,26 @@
 #include "debugging.h"
 #include "io.h"
 #include "gexf.h"
+#include "tlog.h"
+#include "metrics.h"
+#include "simulate.h"
+#include "profile.h"
 #include "finish.h"
 
 /** Do stuff at end of the simulation.
  */
 void finish ()
 {
-    // forward to end of simulation time:
-    current_t = max_t;  // TODO: do we need this?
+    // (output files are all completed and closed before a write error in one of them is reported,
+    // so that the background writers have stopped when the error ends the run):
+    const char* write_error = NULL;
+
+    // (the last rows of the time series are for the time reached, not max_t):
+    try { finish_metrics(); } catch (const char* msg) { write_error = msg; }
+
+    // forward to end of simulation time (unless it is .inf or the run was stopped early by limits:wall or limits:rss,
+    // so that surviving links end at the time reached and a resumed run continues from there):
+    if ((stopped_by_limit == "") && (max_t < INFINITY)) current_t = max_t;  // TODO: do we need this?
 
     if (verbose) {
         cout << "\nat t=" << current_t << ", " << t2ev.size() << " events on stack: " << endl;
@@ -22,10 +34,14 @@ void finish ()
             cout << " " << ev << " at " << t << endl;
         }
     }
-    log_state();
+    log_state(progress_summary());
     if (!silent) cout << endl;
 
-    finish_gexf();
+    try { finish_tlog(); } catch (const char* msg) { if (write_error == NULL) write_error = msg; }
+    try { finish_gexf(); } catch (const char* msg) { if (write_error == NULL) write_error = msg; }
+    if (write_error != NULL) throw write_error;
+
+    report_profile();
 
     if (debug) verify_data_consistency();
 
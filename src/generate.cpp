@@ -0,0 +1,204 @@
+/** tricl_generate, a generator of large synthetic configs for scaling experiments
+ *
+ *  \file
+ *
+ *  Usage: ``tricl_generate [options] output_prefix``
+ *
+ *  Writes a config file ``<output_prefix>.yaml`` and one csv file of initial links
+ *  ``<output_prefix>_<entity type>_<relationship type>_<entity type>.csv`` per link type.
+ *  The entities are split evenly into --entity-types types, and each entity gets
+ *  out-links of each of --relationship-types types, whose no. follows the given degree distribution
+ *  (constant, poisson, or power law with the given exponent) with the given mean,
+ *  to targets drawn uniformly from all entities.
+ *
+ *  The dynamics keep the expected link density stationary without influences:
+ *  each link is terminated at rate tau and each unlinked pair gets linked at rate tau k / (N - k).
+ *  In addition, each of the possible angle types ``[~, <relationship type>, <entity type>, <relationship type>, ~]``
+ *  influences the establishment of each link type with probability --influence-density,
+ *  adding an attempt rate of a tau / k per angle (a = --influence-rate).
+ *  These constants are metaparameters of the generated config, so they can be varied afterwards.
+ *
+ *  The csv files refer to entities by their no. within their type and are read with label prefixes,
+ *  so that tricl can read them fast. They are named relative to the current folder,
+ *  so tricl must be run from the same folder as tricl_generate.
+ */
+
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <random>
+
+#include "3rdparty/cxxopts.hpp"
+
+#include "global_variables.h"
+#include "sink.h"
+
+int main (int argc, char *argv[])
+{
+    try
+    {
+        cxxopts::Options options("tricl_generate", "generate a large synthetic tricl config file with csv files of initial links");
+        options.add_options()
+                ("help", "Print help")
+                ("output", "prefix of the names of the generated files", cxxopts::value<string>())
+                ("entities", "total no. of entities N", cxxopts::value<double>()->default_value("10000"))
+                ("entity-types", "no. of entity types", cxxopts::value<int>()->default_value("1"))
+                ("relationship-types", "no. of relationship types", cxxopts::value<int>()->default_value("1"))
+                ("symmetric", "make the relationship types symmetric")
+                ("degrees", "out-degree distribution per relationship type: constant, poisson, or power law", cxxopts::value<string>()->default_value("poisson"))
+                ("mean-degree", "mean out-degree k per relationship type", cxxopts::value<double>()->default_value("10"))
+                ("exponent", "exponent of the power law degree distribution (> 2)", cxxopts::value<double>()->default_value("2.5"))
+                ("influence-density", "probability that an angle type influences a link type's establishment", cxxopts::value<double>()->default_value("0.5"))
+                ("influence-rate", "attempt rate per influencing angle, in units of tau / k", cxxopts::value<double>()->default_value("0.5"))
+                ("max-t", "limits:t of the generated config, in units of 1 / tau", cxxopts::value<string>()->default_value("10"))
+                ("events", "limits:events of the generated config", cxxopts::value<string>()->default_value("1e6"))
+                ("seed", "random seed of the generator", cxxopts::value<unsigned>()->default_value("1"))
+                ;
+        options.parse_positional({ "output" });
+        options.positional_help("output_prefix");
+        auto opts = options.parse(argc, argv);
+        if ((opts.count("help") > 0) || (opts.count("output") == 0)) {
+            cout << options.help() << endl;
+            return (opts.count("help") > 0) ? 0 : 1;
+        }
+        string prefix = opts["output"].as<string>(), distribution = opts["degrees"].as<string>();
+        long int n = llround(opts["entities"].as<double>());
+        int n_ets = opts["entity-types"].as<int>(), n_rats = opts["relationship-types"].as<int>();
+        double k = opts["mean-degree"].as<double>(), exponent = opts["exponent"].as<double>();
+        double influence_density = opts["influence-density"].as<double>();
+        bool symmetric = (opts.count("symmetric") > 0);
+        unsigned generator_seed = opts["seed"].as<unsigned>();
+        if ((n_ets < 1) || (n_rats < 1) || (n < n_ets)) throw "need at least one entity type, one relationship type, and one entity per type";
+        if (!(k >= 0) || !(k < n - 1)) throw "mean-degree must be between 0 and the no. of entities - 1";
+        if ((distribution != "constant") && (distribution != "poisson") && (distribution != "power law")) throw
+                "degrees must be constant, poisson, or power law";
+        if ((distribution == "power law") && !(exponent > 2)) throw "exponent must be larger than 2";
+        if (n > MAX_N_E) cerr << "WARNING: tricl currently supports at most " << MAX_N_E
+                << " entities (recompile with larger E_BITS in data_model.h)" << endl;
+        auto t0 = std::chrono::steady_clock::now();
+
+        // entity types and relationship types, with the first entity no. of each entity type:
+        vector<string> et_labels, rat_labels;
+        vector<long int> et_first = { 0 };
+        for (int i = 0; i < n_ets; i++) {
+            et_labels.push_back("type" + to_string(i + 1));
+            et_first.push_back(et_first.back() + n / n_ets + ((i < n % n_ets) ? 1 : 0));
+        }
+        for (int r = 0; r < n_rats; r++) rat_labels.push_back("rel" + to_string(r + 1));
+        auto csv_filename = [&](int i, int r, int j) {
+            return prefix + "_" + et_labels[i] + "_" + rat_labels[r] + "_" + et_labels[j] + ".csv";
+        };
+
+        // initial links, written for one source entity type and relationship type at a time:
+        long int n_links = 0;
+        for (int r = 0; r < n_rats; r++) {
+            for (int i = 0; i < n_ets; i++) {
+                vector<std::unique_ptr<output_sink>> sinks;
+                for (int j = 0; j < n_ets; j++) sinks.emplace_back(new output_sink(csv_filename(i, r, j), CM_NONE));
+                std::mt19937_64 rng(generator_seed + 1000003ULL * (r * n_ets + i));
+                std::poisson_distribution<long int> poisson(k);
+                std::uniform_real_distribution<double> u01(0, 1);
+                double x_min = k * (exponent - 2) / (exponent - 1);  // so that the Pareto distribution has mean k
+                std::uniform_int_distribution<long int> random_other(0, n - 2);
+                vector<long int> targets;
+                for (long int e1 = et_first[i]; e1 < et_first[i + 1]; e1++) {
+                    long int d = (distribution == "constant") ? lround(k)
+                            : (distribution == "poisson") ? poisson(rng)
+                            : (long int) floor(x_min * pow(1 - u01(rng), -1 / (exponent - 1)));
+                    d = min(d, n - 1);
+                    // draw d distinct targets from the n - 1 others, redrawing duplicates:
+                    targets.clear();
+                    while ((long int) targets.size() < d) {
+                        for (long int m = targets.size(); m < d; m++) {
+                            long int x = random_other(rng);
+                            targets.push_back((x < e1) ? x : x + 1);  // (no self-links)
+                        }
+                        sort(targets.begin(), targets.end());
+                        targets.erase(unique(targets.begin(), targets.end()), targets.end());
+                    }
+                    int j = 0;
+                    for (auto e3 : targets) {
+                        while (e3 >= et_first[j + 1]) j++;
+                        *sinks[j] << e1 - et_first[i] << ',' << e3 - et_first[j] << '\n';
+                    }
+                    n_links += targets.size();
+                }
+                for (auto& s : sinks) s->close();
+            }
+        }
+
+        // config file:
+        std::ofstream y(prefix + ".yaml");
+        if (!y) throw "cannot write config file";
+        y << "metadata:\n"
+          << "    name: synthetic config generated by tricl_generate\n"
+          << "    description: " << n << " entities of " << n_ets << " types, " << n_rats << (symmetric ? " symmetric" : "")
+          << " relationship types, " << distribution << " out-degrees with mean " << k
+          << ", influence density " << influence_density << "\n\n"
+          << "metaparameters:\n"
+          << "    N: " << n << "  # total no. of entities\n"
+          << "    k: " << k << "  # mean out-degree per relationship type\n"
+          << "    tau: 1.0  # termination rate\n"
+          << "    a: " << opts["influence-rate"].as<double>() << "  # attempt rate per influencing angle, in units of tau / k\n\n"
+          << "limits:\n"
+          << "    t: (" << opts["max-t"].as<string>() << ") / tau\n"
+          << "    events: " << opts["events"].as<string>() << "\n\n"
+          << "entities:\n";
+        for (int i = 0; i < n_ets; i++) y << "    " << et_labels[i] << ": " << et_first[i + 1] - et_first[i] << "\n";
+        y << "\nrelationship types:\n";
+        for (int r = 0; r < n_rats; r++) y << "    " << rat_labels[r] << ": " << (symmetric ? "symmetric" : "~") << "\n";
+        y << "\ninitial links:\n";
+        for (int r = 0; r < n_rats; r++) {
+            for (int i = 0; i < n_ets; i++) {
+                for (int j = 0; j < n_ets; j++) {
+                    y << "    \"" << csv_filename(i, r, j) << "\":\n"
+                      << "        type: [" << et_labels[i] << ", " << rat_labels[r] << ", " << et_labels[j] << "]\n"
+                      << "        cols: [0, 1]\n"
+                      << "        prefix: [\"" << et_labels[i] << "_\", \"" << et_labels[j] << "_\"]\n";
+                }
+            }
+        }
+        y << "\ndynamics:\n";
+        std::mt19937_64 rng(generator_seed);
+        std::uniform_real_distribution<double> u01(0, 1);
+        long int n_influences = 0;
+        for (int r = 0; r < n_rats; r++) {
+            for (int i = 0; i < n_ets; i++) {
+                for (int j = 0; j < n_ets; j++) {
+                    y << "    [" << et_labels[i] << ", " << rat_labels[r] << ", " << et_labels[j] << "]:\n"
+                      << "        establish:\n"
+                      << "            attempt:\n"
+                      << "                basic: tau * k / (N - k)\n";
+                    for (int r12 = 0; r12 < n_rats; r12++) {
+                        for (int m = 0; m < n_ets; m++) {
+                            for (int r23 = 0; r23 < n_rats; r23++) {
+                                if (u01(rng) < influence_density) {
+                                    y << "                [~, " << rat_labels[r12] << ", " << et_labels[m] << ", " << rat_labels[r23] << ", ~]: a * tau / k\n";
+                                    n_influences++;
+                                }
+                            }
+                        }
+                    }
+                    y << "            success: .inf\n"
+                      << "        terminate:\n"
+                      << "            attempt:\n"
+                      << "                basic: tau\n"
+                      << "            success: .inf\n";
+                }
+            }
+        }
+        y.close();
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        cout << "wrote " << prefix << ".yaml with " << n_influences << " influences and " << n_rats * n_ets * n_ets
+             << " csv files with " << n_links << " initial links in " << seconds << " s" << endl;
+    }
+    catch (const char* msg)
+    {
+        cerr << "ERROR: exiting with message: " << msg << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -19,74 +19,62 @@
  *  but via the config file, individual types can also be suppressed or
  *  redirected to other files.
  *  (Note that gephi allows uniting several files into one workspace.)
+ *
+ *  Edges are formatted, compressed and written by a background thread (see \ref async_writer.h),
+ *  so that the simulation does not wait for compression.
  */
 
+#include <memory>
+
 #include "global_variables.h"
+#include "async_writer.h"
 #include "gexf.h"
+#include "profile.h"
+#include "simulate.h"
+#include "sink.h"
 
-// tell boost header files to use gzip and zlib instead of their own libs:
-#define BOOST_IOSTREAMS_NO_LIB
-#include <boost/iostreams/filtering_streambuf.hpp>
-#include <boost/iostreams/filter/gzip.hpp>
-
-unordered_map<string, bool> gexf_is_gz;  ///< whether an output file is gzip-compressed
-unordered_map<string, ofstream> gexf_uncompressed, gexf_compressed;  ///< streams for uncompressed and compressed output
-unordered_map<string, boost::iostreams::filtering_streambuf<boost::iostreams::output>> gexf_buf;  ///< buffer for compressed output
-ostream* gexf(NULL);  ///< actual stream to write to
+unordered_map<string, std::unique_ptr<output_sink>> gexf_sink;  ///< Output sink by file name, owned for the whole run
 
-unordered_map<tricl::tricllink, timepoint> gexf_edge2start = {};  ///< Time of establishment of edge
-
-/** \returns the stream to write to.
- *
- *  NOTE: for some reason this apparently cannot be stored permanently in a global variable between writes.
+/** Data of an edge to be written by the background thread.
  */
-inline ostream* get_stream (string fn, bool is_gz)
+struct gexf_edge_record
 {
-    if (is_gz) {
-        ostream gexf_gz(&(gexf_buf[fn]));
-        gexf = (ostream*)(&gexf_gz);
-    } else {
-        gexf = (ostream*)(&(gexf_uncompressed[fn]));
-    }
-    return gexf;
-}
+    entity e1;
+    relationship_or_action_type rat13;
+    entity e3;
+    long int n_events;  ///< No. of events when the edge was completed, used in the edge id
+    timepoint start, end;
+};
+
+void write_gexf_edge (gexf_edge_record& r);
+
+unordered_map<relationship_or_action_type, output_sink*> rat2gexf_sink;  ///< Sink to write edges of a relationship or action type to (if any)
+async_writer<gexf_edge_record> gexf_writer;  ///< Background thread writing edges
 
 /** Prepare gexf output.
  *
- *  Opens files, streams, buffers and outputs file headers with all entities.
+ *  Opens files and outputs file headers with all entities.
  */
 void init_gexf ()
 {
     if (verbose) cout << " prepare gexf output files:" << endl;
     // open files:
     for (auto& [rat13, fn] : gexf_filename) {
-        if ((fn != "") && (gexf_is_gz.count(fn)==0)) {
+        if ((fn != "") && (gexf_sink.count(fn)==0)) {
             // get file extension:
             auto ext = fn.substr(fn.find_last_of(".") + 1);
-            if (ext == "gexf")
-            {
-                // uncompressed
-                gexf_is_gz[fn] = false;
-                gexf_uncompressed[fn].open(fn);
-            }
-            else if (ext == "gz")
-            {
-                // compressed
-                gexf_is_gz[fn] = true;
-                gexf_compressed[fn] = ofstream(fn, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
-                // prepare boost's compression buffer:
-                gexf_buf[fn].push(boost::iostreams::gzip_compressor());
-                gexf_buf[fn].push(gexf_compressed[fn]);
-            }
+            if (ext == "gexf") gexf_sink[fn].reset(new output_sink(fn, CM_NONE));
+            else if (ext == "gz") gexf_sink[fn].reset(new output_sink(fn,
+                    (gexf_compression.count(fn) > 0) && (gexf_compression.at(fn) == "parallel gzip") ? CM_PARALLEL_GZIP : CM_GZIP));
             else throw "files:gexf must end with .gexf or .gexf.gz";
         }
     }
 
     // output all nodes into all files:
-    for (auto& [fn, is_gz] : gexf_is_gz) {
-        if (fn != "") {
+    for (auto& [fn, sink] : gexf_sink) {
+        if (sink) {
             if (verbose) cout << "  " << fn << endl;
-            gexf = get_stream(fn, is_gz);
+            auto gexf = sink.get();
             // give all attributes one-letter ids so that they can be accessed
             // as global variables in Gephi's python scripting plugin:
 //            *gexf << R"V0G0N(<?xml version="1.0" encoding="UTF-8"?>
@@ -110,9 +98,9 @@ void init_gexf ()
 <!--0--> <gexf xmlns="http://www.gexf.net/1.2draft" version="1.2" xmlns:viz="http://www.gexf.net/1.1draft/viz"><meta><creator>tricl</creator><description>dynamic graph generated by tricl model</description></meta><graph mode="dynamic" defaultedgetype="directed"><attributes class="node"><attribute id="T" title="entity type" type="string"/></attributes><attributes class="edge"><attribute id="R" title="relationship or action type" type="string"/><attribute id="S" title="start" type="float"/><attribute id="E" title="end" type="float"/></attributes><nodes>)V0G0N";
             for (auto& e : es) {
                 auto et = e2et[e];
-                *gexf << "<node id=\"" << e << "\" label=\"" << e2label[e]
-                     << "\" start=\"0.0\" end=\"" << max_t
-                     << "\"><attvalues><attvalue for=\"T\" value=\""
+                *gexf << "<node id=\"" << e << "\" label=\"" << e2label[e] << "\" start=\"0.0\"";
+                if (max_t < INFINITY) *gexf << " end=\"" << max_t << "\"";  // (without limits:t, nodes exist forever)
+                *gexf << "><attvalues><attvalue for=\"T\" value=\""
                      << et2label[et] << "\"/></attvalues>";
                 // output visualization information:
                 if (et2gexf_size.count(et) > 0) *gexf
@@ -130,9 +118,15 @@ void init_gexf ()
             *gexf << R"V0G0N(</nodes><edges>)V0G0N";
         }
     }
+
+    // from now on, the sinks are only used by the background thread:
+    for (auto& [rat13, fn] : gexf_filename) {
+        if (fn != "") rat2gexf_sink[rat13] = gexf_sink.at(fn).get();
+    }
+    if (!rat2gexf_sink.empty()) gexf_writer.start(write_gexf_edge);
 }
 
-/** Write a single edge to the proper file.
+/** Write a single edge to the proper file (called by the background thread).
  *
  *  The unique edge id is <et1>_<rat13>_<et3>_<n_events>.
  *  Start and end time are stored both in the "start"/"end" xml attributes
@@ -140,35 +134,48 @@ void init_gexf ()
  *  as well as in gexf "attributes" named "S"/"E"
  *  so that one can access them as global variables in gephi's python scripting plugin.
  */
-void gexf_output_edge (tricl::tricllink& l) {
-    auto e1 = l.e1, e3 = l.e3;
+void write_gexf_edge (gexf_edge_record& r)
+{
+    auto e1 = r.e1, e3 = r.e3;
+    auto rat13 = r.rat13;
+    auto n_events = r.n_events;
+    double start = r.start, end = r.end;
+    output_sink* gexf = rat2gexf_sink.at(rat13);
+    *gexf << "<!--"  << e1 << "_" << rat13 << "_" << e3 << "_" << n_events
+          << "--> <edge id=\"" << e1 << "_" << rat13 << "_" << e3 << "_" << n_events
+          << "\" source=\"" << e1
+          << "\" target=\"" << e3
+          << "\" start=\"" << start
+          << "\" end=\"" << end
+          << "\"><attvalues><attvalue for=\"R\" value=\"" << rat2label.at(rat13)
+          << "\"/><attvalue for=\"S\" value=\"" << start
+          << "\"/><attvalue for=\"E\" value=\"" << end
+          << "\"/></attvalues>";
+    if (rat2gexf_thickness.count(rat13) > 0) *gexf
+          << "<viz:thickness value=\"" << rat2gexf_thickness.at(rat13) << "\"/>";
+    if (rat2gexf_shape.count(rat13) > 0) *gexf
+          << "<viz:shape value=\"" << rat2gexf_shape.at(rat13) << "\"/>";
+    if (rat2gexf_r.count(rat13) > 0) *gexf
+          << "<viz:color r=\"" << rat2gexf_r.at(rat13) << "\" g=\"" << rat2gexf_g.at(rat13) << "\" b=\"" << rat2gexf_b.at(rat13) << "\" a=\"" << rat2gexf_a.at(rat13) << "\"/>";
+    *gexf << "</edge>\n";  // (no flushing after each edge, which would spoil the compression)
+}
+
+/** Hand a single edge over to the background thread for output, if its relationship or action type is output.
+ */
+void gexf_output_edge (
+        tricl::tricllink& l,  ///< [in] the link
+        timepoint start       ///< [in] time at which the link was established
+        )
+{
+    PROFILE_SCOPE(PROF_GEXF_OUTPUT_EDGE);  // (only the simulation thread's share, incl. waiting for a full queue)
     auto rat13 = l.rat13;
     if (rat13 != RT_ID) {
-        string fn = gexf_filename[rat13];
-        if (fn != "") {
-            if (verbose) cout << "    writing link to " << fn << endl;
-            gexf = get_stream(fn, gexf_is_gz[fn]);
-            double start = gexf_edge2start.at(l), end = current_t;
-            *gexf << "<!--"  << e1 << "_" << rat13 << "_" << e3 << "_" << n_events
-                  << "--> <edge id=\"" << e1 << "_" << rat13 << "_" << e3 << "_" << n_events
-                  << "\" source=\"" << e1
-                  << "\" target=\"" << e3
-                  << "\" start=\"" << start
-                  << "\" end=\"" << end
-                  << "\"><attvalues><attvalue for=\"R\" value=\"" << rat2label[rat13]
-                  << "\"/><attvalue for=\"S\" value=\"" << start
-                  << "\"/><attvalue for=\"E\" value=\"" << end
-                  << "\"/></attvalues>";
-            if (rat2gexf_thickness.count(rat13) > 0) *gexf
-                  << "<viz:thickness value=\"" << rat2gexf_thickness[rat13] << "\"/>";
-            if (rat2gexf_shape.count(rat13) > 0) *gexf
-                  << "<viz:shape value=\"" << rat2gexf_shape[rat13] << "\"/>";
-            if (rat2gexf_r.count(rat13) > 0) *gexf
-                  << "<viz:color r=\"" << rat2gexf_r[rat13] << "\" g=\"" << rat2gexf_g[rat13] << "\" b=\"" << rat2gexf_b[rat13] << "\" a=\"" << rat2gexf_a[rat13] << "\"/>";
-            *gexf << "</edge>" << endl;
+        if (rat2gexf_sink.count(rat13) > 0) {
+            if (verbose) cout << "    writing link to " << gexf_filename.at(rat13) << endl;
+            gexf_writer.push({ .e1 = l.e1, .rat13 = rat13, .e3 = l.e3, .n_events = n_events,
+                               .start = start, .end = current_t });
         }
     }
-    if (gexf_edge2start.erase(l) != 1) throw "missing link start time";
 }
 
 /** Complete and close all output files.
@@ -179,28 +186,30 @@ void finish_gexf () {
     if (verbose) cout << " write surviving links to gexf output files" << endl;
     bool old_verbose = verbose;
     verbose = false;
-    current_t = max_t;  // TODO: is this correct/neccessary/helpful?
+    if ((stopped_by_limit == "") && (max_t < INFINITY)) current_t = max_t;  // TODO: is this correct/neccessary/helpful?
     for (auto& [e1, outs] : e2outs) {
-        for (auto& [rat13, e3] : outs) {
-            tricl::tricllink l = { .e1 = e1, .rat13 = rat13, .e3 = e3 };
-            if (rat13 != RT_ID) gexf_output_edge(l);
+        for (auto& leg : outs) {
+            tricl::tricllink l = { .e1 = e1, .rat13 = leg.rat_out, .e3 = leg.e_target };
+            if (l.rat13 != RT_ID) gexf_output_edge(l, leg.t_start);
         }
     }
     verbose = old_verbose;
+    gexf_writer.stop();
 
     // output footer to all files:
     if (!quiet) cout << " complete gexf output files:" << endl;
-    for (auto& [fn, is_gz] : gexf_is_gz) {
-        if (fn != "") {
+    for (auto& [fn, sink] : gexf_sink) {
+        if (sink) {
             if (!quiet) cout << "  " << fn << endl;
-            gexf = get_stream(fn, is_gz);
-//            *gexf << R"V0G0N(        </edges>
+//            *sink << R"V0G0N(        </edges>
 //    </graph>
 //</gexf>
 //)V0G0N";
-            *gexf << R"V0G0N(<!--Z--> </edges></graph></gexf>)V0G0N" << endl;
-            if (!is_gz) gexf_uncompressed[fn].close();
+            *sink << R"V0G0N(<!--Z--> </edges></graph></gexf>)V0G0N" << '\n';
+            sink->close();
         }
     }
+    gexf_sink.clear();
+    rat2gexf_sink.clear();
 }
 
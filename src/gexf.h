@@ -4,11 +4,9 @@
 
 #include "data_model.h"
 
-extern unordered_map<tricllink, timepoint> gexf_edge2start;
-
 void init_gexf ();
 
-void gexf_output_edge (tricllink& l);
+void gexf_output_edge (tricllink& l, timepoint start);
 
 void finish_gexf ();
 
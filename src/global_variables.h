@@ -34,8 +34,29 @@ extern bool verbose;                ///< Whether to output more detailed informa
 extern string diagram_fileprefix;   ///< Prefix of name of (or path to) generated diagram files
 extern timepoint max_t;             ///< Maximal model time to simulate until
 extern long int max_n_events;       ///< Max. no. events to simulate before stopping
+extern double max_wall_seconds;     ///< Max. wall time since program start before stopping early (with a snapshot)
+extern double max_rss_mb;           ///< Max. resident memory in MB before stopping early (with a snapshot)
 extern unsigned seed;               ///< Random seed (if 0, generate a random seed)
+extern unsigned long replicate;     ///< No. of replicate run, selects an independent random stream for the same seed
+extern unsigned long n_replicates;  ///< No. of replicates to run from the same initial state, each in its own process (see \ref select_replicate)
+extern unsigned n_threads;          ///< No. of threads to use for initialization and parallel compression (if 0, use all hardware threads)
+extern double progress_seconds;     ///< Wall time between progress lines
+extern long int progress_n_events;  ///< No. of events between progress lines (if LONG_MAX, only by wall time)
 extern unordered_map<relationship_or_action_type, string> gexf_filename;  ///< Names of (or paths to) generated gexf (or gexf.gz) files by relationship or action type
+extern unordered_map<string, string> gexf_compression;  ///< Compression method ("gzip" or "parallel gzip") by name of gexf.gz file, if not the default "gzip"
+extern string tlog_filename;        ///< Name of (or path to) generated binary event log file (if "", none)
+extern string metrics_filename;     ///< Name of (or path to) generated metrics csv (or csv.gz) file (if "", none)
+extern timepoint metrics_dt;        ///< Model time between rows of the metrics file
+extern long int metrics_n_events;   ///< No. of events between rows of the metrics file
+extern string profile_filename;     ///< Name of (or path to) generated profiling json file (if "", none; requires TRICL_PROFILE)
+extern string snapshot_filename;    ///< Name of (or path to) snapshot file to write (if "", none)
+extern timepoint snapshot_dt;       ///< Model time between snapshots
+extern long int snapshot_n_events;  ///< No. of events between snapshots
+extern string resume_filename;      ///< Name of (or path to) snapshot file to resume from (if "", start a new run)
+extern string branch_label;         ///< Label of the scenario branch run by this process (if "", none)
+extern int branch_no;               ///< No. of the scenario branch run by this process, 1... (if 0, none)
+extern string child_label;          ///< Label of this branch or replicate child process, which names its log file (if "", not a child process)
+extern unordered_map<string, string> branch_metaparameters;  ///< Metaparameter values or expressions overridden by the branch
 
 // structure parameters:
 
@@ -48,7 +69,7 @@ extern unordered_map<string, relationship_or_action_type> label2rat;  ///< Inver
 extern unordered_map<relationship_or_action_type, bool> r_is_action_type; ///< Whether relationship or action type is an action type (not implemented yet)
 extern unordered_map<relationship_or_action_type, relationship_or_action_type> rat2inv; ///< Inverse type of a relationship or action type (e.g. the inverse of "follows" would be "is followed by", the inverse of "meets" would be "meets"). If NO_RAT, inverse has no individual label
 // any preregistered initial links:
-extern set<tricllink> initial_links;                                       ///< Set of named initial links
+extern vector<tricllink> initial_links;                                    ///< Named initial links (possibly with duplicates)
 // random initial links:
 // block model:
 extern unordered_map<entity_type, int> et2n_blocks;                   ///< No. of blocks for random block model by entity type
@@ -57,6 +78,7 @@ extern unordered_map<link_type, probability> lt2initial_prob_between; ///< Betwe
 // random geometric model:
 extern unordered_map<entity_type, int> et2dim;                        ///< No. of spatial dimensions for random geometric model by entity type
 extern unordered_map<link_type, probability> lt2spatial_decay;        ///< Rate of exponential decay of link probability for random geometric model by link type
+extern unordered_map<link_type, probability> lt2spatial_tolerance;    ///< Link probability below which random geometric model uses skip-sampling instead of a cell list, by link type (0: automatic)
 
 // dynamic parameters:
 
@@ -90,7 +112,7 @@ extern unordered_map<relationship_or_action_type, int> rat2gexf_r,
 // VARIABLE DATA:
 
 extern timepoint current_t;       ///< Current model time point
-extern timepoint last_dt;         ///< Time between last and current event
+extern timepoint last_dt;         ///< Time since the last performed event
 extern long int n_events;         ///< No. of events that occurred so far
 extern event current_ev;          ///< Current event
 extern event_data* current_evd_;  ///< Pointer to event data of current event
@@ -10,9 +10,14 @@
 #include "event.h"
 #include "graphviz.h"
 #include "gexf.h"
+#include "tlog.h"
+#include "metrics.h"
 #include "init.h"
 #include "io.h"
 #include "debugging.h"
+#include "parallel.h"
+#include "snapshot.h"
+#include "branch.h"
 
 // parameters:
 int n_rats = 0; // total no. of rats
@@ -129,17 +134,22 @@ void init_relationship_or_action_types ()
     n_rats = rat2label.size();
 }
 
-/** Set up initial schedule of summary events.
+/** Determine possible event types and the constants of summary events.
  */
-void init_events ()
+void init_event_constants ()
 {
-
     for (auto& [evt, ar] : evt2base_attempt_rate) {
         if (ar > 0.0) possible_evts.insert(evt);
     }
     for (auto& [inflt, ar] : inflt2attempt_rate) {
         if (ar > 0.0) possible_evts.insert(inflt.evt);
     }
+    // make sure the base attempt rate and single effective rate of each possible event type
+    // can be looked up without inserting (default 0):
+    for (auto& evt : possible_evts) {
+        evt2base_attempt_rate.try_emplace(evt, 0.0);
+        summary_evt2single_effective_rate.try_emplace(evt, 0.0);
+    }
     if (verbose) {
         if (!silent) cout << " possible event types with base attempt rates and base success probabilities:" << endl;
         for (auto& evt : possible_evts) cout << "  " << evt << ": " << evt2base_attempt_rate[evt] <<
@@ -147,8 +157,6 @@ void init_events ()
     }
 
     // summary events for purely spontaneous establishment without angles:
-
-    if (!quiet) cout << " initial scheduling of summary events..." << endl;
     for (auto& [ets, relations] : ets2relations) {
         auto et1 = ets.et1, et3 = ets.et3;
         for (auto& rat13 : relations) {
@@ -172,6 +180,28 @@ void init_events ()
                     }
                 }
                 summary_ev2max_success_probability[summary_ev] = probunits2probability(max_spu, left_tail, right_tail);
+            }
+        }
+    }
+}
+
+/** Set up initial schedule of summary events.
+ */
+void init_events ()
+{
+    if (!quiet) cout << " initial scheduling of summary events..." << endl;
+    for (auto& [ets, relations] : ets2relations) {
+        auto et1 = ets.et1, et3 = ets.et3;
+        for (auto& rat13 : relations) {
+            event summary_ev = { .ec = EC_EST,
+                    .e1 = (entity)-et1, // in spontaneous events, fields e1 and e3 are used to store entity types with negative sign
+                    .rat13 = rat13,
+                    .e3 = (entity)-et3 };
+            event_type evt = { .ec = EC_EST, .et1 = et1, .rat13 = rat13, .et3 = et3 };
+            auto ar1 = evt2base_attempt_rate[evt];
+            if (ar1 > 0) {
+                probunits spu0 = evt2base_probunits.at(evt);
+                double left_tail = evt2left_tail.at(evt), right_tail = evt2right_tail.at(evt);
                 if (verbose) cout << "  " << et2label[et1] << " " << rat2label[rat13] << " " << et2label[et3] << endl;
                 rate ar_all = ar1 * et2n[et1] * et2n[et3];
                 ev2data[summary_ev] = {
@@ -193,46 +223,294 @@ void init_events ()
     if (!quiet) cout << "  ...done."<< endl;
 }
 
+/** Add all initial links at once and schedule all events that depend on them.
+ *
+ *  Instead of performing one establishment event per link, which would update
+ *  all adjacent events each time, the complete adjacency is built first
+ *  and then the data of each affected event is compiled once from it.
+ *  Since waiting times are memoryless, this yields the same distribution
+ *  of the initial schedule as performing the links one by one.
+ *
+ *  The per-entity work is spread over \ref n_threads threads, each handling a contiguous
+ *  range of entities and only reading shared data. Their results are merged in increasing
+ *  order of entities, so the outcome does not depend on the no. of threads.
+ *
+ *  Must be called before any non-identity links exist.
+ */
+void add_initial_links (
+        vector<vector<outleg>>& e2new_outs  ///< [in] outlegs to add by source entity, incl. those of inverse links, possibly with duplicates (will be cleared)
+        )
+{
+    assert (n_links == 0);
+    size_t n_e = max_e + 1;
+
+    // build the outleg sets:
+    parallel_for(n_e, [&](unsigned chunk, size_t begin, size_t end) {
+        for (entity e1 = max((entity)begin, (entity)1); e1 < (entity)end; e1++) {
+            auto& new_outs = e2new_outs[e1];
+            new_outs.push_back({ .rat_out = RT_ID, .e_target = e1 });
+            sort(new_outs.begin(), new_outs.end());
+            new_outs.erase(unique(new_outs.begin(), new_outs.end()), new_outs.end());
+            for (auto& l : new_outs) l.t_start = current_t;  // birth time for later output
+            e2outs.at(e1) = outleg_set(boost::container::ordered_unique_range, new_outs.begin(), new_outs.end());
+            vector<outleg>().swap(new_outs);
+        }
+    });
+
+    // register the links, visiting source entities in increasing order so that inlegs come out sorted:
+    vector<vector<inleg>> e2new_ins(n_e);
+    for (entity e1 = 1; e1 <= max_e; e1++) {
+        auto et1 = e2et[e1];
+        for (auto& l : e2outs.at(e1)) {
+            auto rat13 = l.rat_out; auto e3 = l.e_target;
+            assert ((e3 != e1) || (rat13 == RT_ID));
+            e2new_ins[e3].push_back({ .e_source = e1, .rat_in = rat13 });
+            if (rat13 != RT_ID) {
+                // update counts:
+                link_type lt = { et1, rat13, e2et[e3] };
+                lt2n[lt]++;
+                n_links++;
+                // this pair is no longer covered by a summary event:
+                event_type evt = { .ec = EC_EST, lt.et1, rat13, lt.et3 };
+                subtract_effective_rate(summary_evt2single_effective_rate[evt]);
+            }
+        }
+    }
+
+    // build the inleg sets:
+    parallel_for(n_e, [&](unsigned chunk, size_t begin, size_t end) {
+        for (entity e3 = max((entity)begin, (entity)1); e3 < (entity)end; e3++) {
+            auto& new_ins = e2new_ins[e3];
+            e2ins.at(e3) = inleg_set(boost::container::ordered_unique_range, new_ins.begin(), new_ins.end());
+            vector<inleg>().swap(new_ins);
+        }
+    });
+
+    schedule_network_events();
+}
+
+/** Count the angles and schedule the termination events of all links and the establishment events
+ *  influenced by at least one angle, given the current network.
+ *
+ *  Expects the summary events to be scheduled already and their effective rates to be reduced
+ *  by those of all currently linked pairs. Like \ref add_initial_links(), this is done in parallel
+ *  and merged in increasing order of entities.
+ */
+void schedule_network_events ()
+{
+    size_t n_e = max_e + 1;
+
+    // count angles that are not merely legs:
+    vector<long int> chunk2n_angles(n_threads, 0);
+    parallel_for(n_e, [&](unsigned chunk, size_t begin, size_t end) {
+        long int na = 0;
+        for (entity e2 = max((entity)begin, (entity)1); e2 < (entity)end; e2++) {
+            auto& ins2 = e2ins.at(e2);
+            auto& outs2 = e2outs.at(e2);
+            long int n_in = ins2.size() - 1, n_out = outs2.size() - 1;  // without identity
+            na += n_in * n_out;
+            // subtract angles that lead back to their source entity:
+            auto in_it = ins2.begin(); auto out_it = outs2.begin();
+            while ((in_it != ins2.end()) && (out_it != outs2.end())) {
+                if (in_it->e_source < out_it->e_target) in_it++;
+                else if (out_it->e_target < in_it->e_source) out_it++;
+                else {
+                    auto e = in_it->e_source;
+                    long int k_in = 0, k_out = 0;
+                    for (; (in_it != ins2.end()) && (in_it->e_source == e); in_it++) k_in++;
+                    for (; (out_it != outs2.end()) && (out_it->e_target == e); out_it++) k_out++;
+                    if (e != e2) na -= k_in * k_out;
+                }
+            }
+        }
+        chunk2n_angles[chunk] = na;
+    });
+    n_angles = 0;
+    for (auto na : chunk2n_angles) n_angles += na;
+
+    // compile the data of the termination events of all links and of the establishment events
+    // influenced by at least one angle:
+    vector<vector<pair<event, event_data>>> chunk2evds(n_threads);
+    parallel_for(n_e, [&](unsigned chunk, size_t begin, size_t end) {
+        auto& evds = chunk2evds[chunk];
+        vector<pair<entity, relationship_or_action_type>> e3rats;
+        for (entity e1 = max((entity)begin, (entity)1); e1 < (entity)end; e1++) {
+            auto et1 = e2et[e1];
+            auto& outs1 = e2outs.at(e1);
+            for (auto& l : outs1) {
+                auto rat13 = l.rat_out; auto e3 = l.e_target;
+                event_type evt = { .ec = EC_TERM, et1, rat13, e2et[e3] };
+                if ((rat13 != RT_ID) && (possible_evts.count(evt) > 0)) {
+                    event ev = { .ec = EC_TERM, e1, rat13, e3 };
+                    evds.push_back({ ev, compile_event_data(ev, outs1, e2ins.at(e3)) });
+                }
+            }
+            // find all establishment events from e1 that some angle (possibly with an identity leg) influences:
+            e3rats.clear();
+            for (auto& l12 : outs1) {
+                auto rat12 = l12.rat_out; auto e2 = l12.e_target; auto et2 = e2et[e2];
+                for (auto& l23 : e2outs.at(e2)) {
+                    auto rat23 = l23.rat_out; auto e3 = l23.e_target;
+                    if (e3 == e1) continue;
+                    auto et3 = e2et[e3];
+                    auto rats_it = ets2relations.find({ et1, et3 });
+                    if (rats_it == ets2relations.end()) continue;
+                    for (auto rat13 : rats_it->second) {
+                        influence_type inflt = { .evt = { .ec = EC_EST, et1, rat13, et3 }, .at = { rat12, et2, rat23 } };
+                        if (COUNT_ALL_ANGLES || (_inflt2attempt_rate[INFLT(inflt)] != 0.0) || (_inflt2delta_probunits[INFLT(inflt)] != 0.0)) {
+                            e3rats.push_back({ e3, rat13 });
+                        }
+                    }
+                }
+            }
+            sort(e3rats.begin(), e3rats.end());
+            e3rats.erase(unique(e3rats.begin(), e3rats.end()), e3rats.end());
+            for (auto& [e3, rat13] : e3rats) {
+                event_type evt = { .ec = EC_EST, et1, rat13, e2et[e3] };
+                if ((possible_evts.count(evt) > 0) && (outs1.count({ .rat_out = rat13, .e_target = e3 }) == 0)) {
+                    event ev = { .ec = EC_EST, e1, rat13, e3 };
+                    evds.push_back({ ev, compile_event_data(ev, outs1, e2ins.at(e3)) });
+                    assert (evds.back().second.n_angles > 0);
+                }
+            }
+        }
+    });
+
+    // schedule them in increasing order of source entity:
+    for (auto& evds : chunk2evds) {
+        for (auto& [ev, evd] : evds) {
+            event_type evt = { .ec = ev.ec, e2et[ev.e1], ev.rat13, e2et[ev.e3] };
+            if (ev.ec == EC_EST) {
+                // this pair is no longer covered by the summary event:
+                subtract_effective_rate(summary_evt2single_effective_rate.at(evt));
+            }
+            PROFILE_EVT(evt, compiled, 1);
+            PROFILE_EVT(evt, compiled_angles, evd.n_angles);
+            auto evd_ = &(ev2data[ev] = evd);
+            schedule_event(ev, evd_, evt2left_tail.at(evt), evt2right_tail.at(evt));
+        }
+        vector<pair<event, event_data>>().swap(evds);
+    }
+}
+
+/** Discard the current schedule and build it anew from the current network.
+ *
+ *  Used when the dynamic parameters may differ from those the schedule was computed with,
+ *  e.g. in a branch resumed from a snapshot. Since waiting times are memoryless,
+ *  redrawing them does not change the distribution of the further evolution.
+ */
+void reschedule_all_events ()
+{
+    ev2data.clear();
+    t2ev.clear();
+    total_finite_effective_rate = 0;
+    n_infinite_effective_rates = 0;
+    init_events();
+    // linked pairs are not covered by summary events:
+    for (entity e1 = 1; e1 <= max_e; e1++) {
+        auto et1 = e2et[e1];
+        for (auto& l : e2outs.at(e1)) {
+            if (l.rat_out == RT_ID) continue;
+            event_type evt = { .ec = EC_EST, et1, l.rat_out, e2et[l.e_target] };
+            auto it = summary_evt2single_effective_rate.find(evt);
+            if (it != summary_evt2single_effective_rate.end()) subtract_effective_rate(it->second);
+        }
+    }
+    schedule_network_events();
+    if (!quiet) cout << "  ...rescheduled " << t2ev.size() << " events." << endl;
+}
+
+/** Draw new times for all scheduled events at their current rates.
+ *
+ *  Used when a replicate continues from a state shared with other replicates (see \ref select_replicate).
+ *  Unlike \ref reschedule_all_events, the events' data are kept, so this is cheap.
+ */
+void redraw_all_event_times ()
+{
+    // (in a fixed order, since drawing uses random numbers:)
+    vector<event> evs;
+    evs.reserve(t2ev.size());
+    for (auto& [t, ev] : t2ev) evs.push_back(ev);
+    for (auto& ev : evs) {
+        event_type evt = get_event_type(ev);
+        reschedule_event(ev, &ev2data.at(ev), evt2left_tail.at(evt), evt2right_tail.at(evt));
+    }
+    if (!quiet) cout << "  ...redrew the times of " << evs.size() << " events." << endl;
+}
+
 /** Add all initial links and corresponding events.
  */
 void init_links ()
 {
     if (!quiet) cout << " perform events that add initial links..." << endl;
 
-    // identity relationship:
-    for (auto& e : es) {
-        e2outs[e].insert({ RT_ID, e });
-        e2ins[e].insert({ e, RT_ID });
-    }
+    // all links are first only collected as outlegs by source entity, incl. inverse links,
+    // and then added at once by add_initial_links():
+    vector<vector<outleg>> e2new_outs(max_e + 1);
+    auto add_initial_link = [&](entity e1, relationship_or_action_type rat13, entity e3) {
+        assert ((rat13 != RT_ID) && (e1 != e3));
+        e2new_outs[e1].push_back({ .rat_out = rat13, .e_target = e3 });
+        auto rat31 = rat2inv.at(rat13);
+        if (rat31 != NO_RAT) e2new_outs[e3].push_back({ .rat_out = rat31, .e_target = e1 });
+    };
 
     // preregistered links:
 
-    for (auto l : initial_links) {
-        assert (!link_exists(l));
-        assert (l.rat13 != RT_ID);
-        event ev = { .ec=EC_EST, l.e1, l.rat13, l.e3 };
-        conditionally_remove_event(ev);
-        // prepair total effective rate since call to perform_event will subtracted INFINITY from it:
-        perform_event(ev, &sure_evd);  // this automatically also adds the inverse link, if any.
+    for (auto& l : initial_links) {
+        add_initial_link(l.e1, l.rat13, l.e3);
     }
+    vector<tricllink>().swap(initial_links);  // free memory
 
     // random links:
 
     // block model:
-    unordered_map<entity, int> e2block = { };
-    for (auto& e : es) {
-        e2block[e] = floor(uniform(random_variable) * et2n_blocks[e2et[e]]);
+    // assign entities to blocks at random and list the members of each block in increasing order:
+    unordered_map<entity_type, vector<vector<entity>>> et2blocks = { };
+    for (auto& [et, n_blocks] : et2n_blocks) {
+        auto& blocks = et2blocks[et] = vector<vector<entity>>(n_blocks);
+        for (auto& e : et2es[et]) {
+            blocks[floor(uniform(random_variable) * n_blocks)].push_back(e);
+        }
     }
-    for (auto& [lt, pw] : lt2initial_prob_within) { // TODO: add lt2initial_prob_between
-        if (pw > 0) {
+    for (auto& [lt, pw] : lt2initial_prob_within) {
+        auto pb = lt2initial_prob_between[lt];
+        if ((pw > 0) || (pb > 0)) {
             if (verbose) cout << "  using a block model for \"" << lt << "\"" << endl;
             assert (lt.rat13 != RT_ID);
             auto et1 = lt.et1, et3 = lt.et3; auto rat13 = lt.rat13;
-            for (auto& e1 : et2es[et1]) {
-                for (auto& e3 : et2es[et3]) {
-                    if ((e3 != e1) && ((e3 > e1) || (rat2inv[rat13] != rat13))) {
-                        float p = (e2block[e1] == e2block[e3]) ? lt2initial_prob_within[lt] : lt2initial_prob_between[lt];
-                        do_random_link(p, e1, rat13, e3);
+            auto& blocks1 = et2blocks.at(et1);
+            auto& blocks3 = et2blocks.at(et3);
+            // draw the links of each pair of blocks by geometric skipping over the possible pairs of entities:
+            if ((et1 == et3) && (rat2inv[rat13] == rat13)) {
+                // symmetric links within one entity type: only draw each unordered pair once, as e1 < e3
+                for (size_t b1 = 0; b1 < blocks1.size(); b1++) {
+                    auto& es1 = blocks1[b1];
+                    // within block b1, the pairs i < j are enumerated row by row:
+                    size_t n1 = es1.size(), i = 1, row_start = 0;
+                    for_random_subset(n1 * (n1 - 1) / 2, pw, [&](size_t k) {
+                        while (k >= row_start + i) { row_start += i; i++; }
+                        add_initial_link(es1[k - row_start], rat13, es1[i]);
+                    });
+                    // between block b1 and a later block b3:
+                    for (size_t b3 = b1 + 1; b3 < blocks3.size(); b3++) {
+                        auto& es3 = blocks3[b3];
+                        for_random_subset(n1 * es3.size(), pb, [&](size_t k) {
+                            auto e1 = es1[k / es3.size()], e3 = es3[k % es3.size()];
+                            add_initial_link(min(e1, e3), rat13, max(e1, e3));
+                        });
+                    }
+                }
+            } else {
+                for (size_t b1 = 0; b1 < blocks1.size(); b1++) {
+                    auto& es1 = blocks1[b1];
+                    for (size_t b3 = 0; b3 < blocks3.size(); b3++) {
+                        auto& es3 = blocks3[b3];
+                        for_random_subset(es1.size() * es3.size(), (b1 == b3) ? pw : pb, [&](size_t k) {
+                            auto e1 = es1[k / es3.size()], e3 = es3[k % es3.size()];
+                            if ((e3 != e1) && ((e3 > e1) || (rat2inv[rat13] != rat13))) {
+                                add_initial_link(e1, rat13, e3);
+                            }
+                        });
                     }
                 }
             }
@@ -240,35 +518,106 @@ void init_links ()
     }
 
     // random geometric model:
-    unordered_map<entity, vector<double>> e2coords = { };
+    // coordinates are stored contiguously by entity type, in the order of et2es:
+    unordered_map<entity_type, vector<double>> et2coords = { };
     for (auto& [et, dim] : et2dim) {
-        for (auto& e : et2es.at(et)) {
-            e2coords[e] = vector<double>(dim);
-            for (int d=0; d<dim; d++) {
-                auto coord = uniform(random_variable);
-                e2coords.at(e)[d] = coord;
-            }
-        }
+        auto& coords = et2coords[et] = vector<double>(et2es.at(et).size() * dim);
+        for (auto& coord : coords) coord = uniform(random_variable);
     }
     for (auto& [lt, ex] : lt2spatial_decay) {
         if (verbose) cout << "  using a random geometric model for \"" << lt << "\"" << endl;
         assert (lt.rat13 != RT_ID);
         auto et1 = lt.et1, et3 = lt.et3; auto rat13 = lt.rat13; auto dim = et2dim.at(et1);
         assert (et2dim.at(et3) == dim);
-        auto es3 = et2es.at(et3);
-        for (auto& e1 : et2es.at(et1)) {
-            for (auto& e3 : es3) {
-                if ((e3 != e1) && ((e3 > e1) || (rat2inv.at(rat13) != rat13))) {
-                    double dist2 = 0.0;
-                    for (int d=0; d<dim; d++) {
-                        dist2 += pow(e2coords.at(e1)[d] - e2coords.at(e3)[d], 2.0);
+        bool symmetric = (rat2inv.at(rat13) == rat13);
+        auto& es1 = et2es.at(et1);
+        auto& es3 = et2es.at(et3);
+        auto& coords1 = et2coords.at(et1);
+        auto& coords3 = et2coords.at(et3);
+        size_t n1 = es1.size(), n3 = es3.size();
+        auto dist = [&](size_t i1, size_t i3) {
+            double dist2 = 0.0;
+            for (int d=0; d<dim; d++) {
+                double delta = coords1[i1*dim + d] - coords3[i3*dim + d];
+                dist2 += delta * delta;
+            }
+            return sqrt(dist2);
+        };
+
+        // pairs closer than the cutoff radius r, where the link probability exceeds the tolerance,
+        // are found via a cell list and drawn individually;
+        // the far tail is covered by skip-sampling with the tolerance as an upper bound.
+        // by default, the tolerance is chosen so that the tail needs O(n1 + n3) draws:
+        probability tol = lt2spatial_tolerance[lt];
+        if (tol == 0.0) tol = min(0.5, (double)(n1 + n3) / ((double)n1 * n3));
+        double r = -log(tol) / ex;
+
+        // cells have width >= r so that all pairs closer than r are in the same or adjacent cells,
+        // and there are not many more cells than entities:
+        size_t cells_per_dim = max(1.0, min(floor(1 / r), floor(pow(n3, 1.0 / dim))));
+        size_t n_cells = round(pow(cells_per_dim, dim));
+        auto cell_coord = [&](double x) {
+            return min((size_t)(x * cells_per_dim), cells_per_dim - 1);
+        };
+        // sort target entities by cell (counting sort):
+        vector<size_t> cell_start(n_cells + 1, 0), cell_members(n3), cell3(n3);
+        for (size_t i3 = 0; i3 < n3; i3++) {
+            size_t c = 0;
+            for (int d=dim-1; d>=0; d--) c = c * cells_per_dim + cell_coord(coords3[i3*dim + d]);
+            cell3[i3] = c;
+            cell_start[c + 1]++;
+        }
+        for (size_t c = 0; c < n_cells; c++) cell_start[c + 1] += cell_start[c];
+        {
+            auto next = cell_start;
+            for (size_t i3 = 0; i3 < n3; i3++) cell_members[next[cell3[i3]]++] = i3;
+        }
+
+        // near pairs: visit all cells adjacent to that of e1:
+        vector<size_t> lo(dim), hi(dim), c(dim);
+        for (size_t i1 = 0; i1 < n1; i1++) {
+            auto e1 = es1[i1];
+            for (int d=0; d<dim; d++) {
+                size_t cd = cell_coord(coords1[i1*dim + d]);
+                lo[d] = (cd > 0) ? cd - 1 : 0;
+                hi[d] = min(cd + 1, cells_per_dim - 1);
+                c[d] = lo[d];
+            }
+            while (true) {
+                size_t cell = 0;
+                for (int d=dim-1; d>=0; d--) cell = cell * cells_per_dim + c[d];
+                for (size_t k = cell_start[cell]; k < cell_start[cell + 1]; k++) {
+                    auto i3 = cell_members[k];
+                    auto e3 = es3[i3];
+                    if ((e3 != e1) && ((e3 > e1) || !symmetric)) {
+                        double d13 = dist(i1, i3);
+                        if ((d13 <= r) && (uniform(random_variable) < exp(-ex * d13))) {
+                            add_initial_link(e1, rat13, e3);
+                        }
                     }
-                    probability p = exp(-ex * sqrt(dist2));
-                    do_random_link(p, e1, rat13, e3);
                 }
+                // advance to next adjacent cell:
+                int d = 0;
+                while ((d < dim) && (c[d] == hi[d])) { c[d] = lo[d]; d++; }
+                if (d == dim) break;
+                c[d]++;
             }
         }
+
+        // far pairs: propose each pair with probability tol and accept it with probability exp(-ex*dist)/tol:
+        for_random_subset(n1 * n3, tol, [&](size_t k) {
+            auto i1 = k / n3, i3 = k % n3;
+            auto e1 = es1[i1], e3 = es3[i3];
+            if ((e3 != e1) && ((e3 > e1) || !symmetric)) {
+                double d13 = dist(i1, i3);
+                if ((d13 > r) && (uniform(random_variable) * tol < exp(-ex * d13))) {
+                    add_initial_link(e1, rat13, e3);
+                }
+            }
+        });
     }
+    add_initial_links(e2new_outs);
+
     // reset cumulative loglikelihood to count only what happens after initial state:
     cumulative_logl = 0;
 
@@ -282,13 +631,44 @@ void init ()
 {
     if (!silent) cout << "INITIALIZING..." << endl;
     if (!silent) cout << " MAX_N_INFLT=" << MAX_N_INFLT << ", MAX_N_E=" << MAX_N_E << endl;
-    init_randomness();
     init_data();
-    init_entities();
-    init_relationship_or_action_types();
-    init_events();
-    init_links();
+    if (resume_filename == "") {
+        init_randomness();
+        init_entities();
+        init_relationship_or_action_types();
+        init_event_constants();
+        init_events();
+        init_links();
+    } else {
+        // entities, links, schedule and random state all come from the snapshot:
+        init_relationship_or_action_types();
+        init_event_constants();
+        restore_snapshot(resume_filename);
+        if (branch_no > 0) {
+            // each branch has its own output files and random stream, and may have different dynamic parameters:
+            add_output_filename_suffix("_" + branch_label);
+            if (snapshot_filename != "") snapshot_filename = filename_with_suffix(snapshot_filename, "_" + branch_label);
+            if (diagram_fileprefix != "") diagram_fileprefix += "_" + branch_label;
+            init_randomness(replicate, branch_no);
+            reschedule_all_events();
+        }
+    }
+    // (a resumed run keeps the summary events' times, which were drawn at the rate of the same bound of their covered pairs)
+    init_summary_samplers((resume_filename == "") || (branch_no > 0));
+    if (n_replicates > 1) {
+        // from here on, each replicate is run in its own process
+        // with its own output files and random stream, starting from the same state:
+        replicate = select_replicate();
+        add_output_filename_suffix("_" + child_label);
+        if (snapshot_filename != "") snapshot_filename = filename_with_suffix(snapshot_filename, "_" + child_label);
+        if (diagram_fileprefix != "") diagram_fileprefix += "_" + child_label;
+        init_randomness(replicate, REPLICATE_STREAM);
+        redraw_all_event_times();
+    }
+    init_snapshots();
     init_gexf();
+    init_tlog();
+    init_metrics();
     do_graphviz_diagrams();
     if (debug) {
         dump_data();
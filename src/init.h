@@ -2,6 +2,12 @@
 #ifndef INC_INIT_H
 #define INC_INIT_H
 
+void schedule_network_events ();
+
+void reschedule_all_events ();
+
+void redraw_all_event_times ();
+
 void init ();
 
 #endif
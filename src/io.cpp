@@ -3,13 +3,26 @@
  *  \file
  */
 
-// use header-only csv library:
-#include "3rdparty/rapidcsv.h"
+// for memory-mapped file access:
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <array>
+#include <chrono>
+#include <deque>
+#include <string_view>
 
 #include "global_variables.h"
 #include "entity.h"
 #include "event.h"
+#include "parallel.h"
 #include "io.h"
+#include "simulate.h"
+
+#define CSV_BATCH_BYTES (1<<26)  ///< No. of bytes of a csv file to tokenize in parallel before resolving their rows
+#define CSV_MAX_ID (1<<22)       ///< Numeric labels below this are resolved via a lookup table (grown as needed) instead of label2e
 
 // overloaded streaming operators need to live in our special namespace:
 namespace tricl {
@@ -64,7 +77,9 @@ double avg_er_times_dt = 0;
 
 /** Output simple statistics for current model state to stdout.
  */
-void log_state ()
+void log_state (
+        const string& progress  ///< [in] progress information to append to the statistics (if any)
+        )
 {
     if (silent) return;
     if (debug) if (last_dt > 0) {  // TODO find out why this product is not 1 on average!
@@ -88,7 +103,7 @@ void log_state ()
         ;
     if (quiet)
     {
-        cout << fixed << n_events << ": logl " << cumulative_logl << ", er " << total_finite_effective_rate << ", ld " << ld << ", ad " << ad << ", q " << q << ".  t " << current_t << "\r";
+        cout << fixed << n_events << ": logl " << cumulative_logl << ", er " << total_finite_effective_rate << ", ld " << ld << ", ad " << ad << ", q " << q << ".  t " << current_t << progress << "\r" << flush;
     }
     else if (lt2n.size() > 1)
     {
@@ -99,15 +114,171 @@ void log_state ()
                 cout << " | " << n << " " << lt;
             }
         }
-        cout << " | stats: logl " << cumulative_logl << ", er " << total_finite_effective_rate << ", ld " << ld << ", ad " << ad << ", q " << q << endl;
+        cout << " | stats: logl " << cumulative_logl << ", er " << total_finite_effective_rate << ", ld " << ld << ", ad " << ad << ", q " << q << progress << endl;
         if (current_t < max_t) cout << "at t=" << current_t << " " << current_ev << defaultfloat << endl;
     }
     else
     {
         cout << fixed << n_events << ": logl " << cumulative_logl << ", er " << total_finite_effective_rate << ", ld " << ld << ", ad " << ad << ", q " << q;
         if (current_t < max_t) cout << ".  t " << current_t << ": " << current_ev << defaultfloat;
-        cout << endl;
+        cout << progress << endl;
+    }
+}
+
+long int next_progress_check = 0;  ///< No. of events at which \ref log_progress_if_due calls \ref log_progress next
+long int next_progress_n_events = LONG_MAX;  ///< No. of events at which the next progress line is due
+long int progress_start_n_events = 0, last_progress_n_events = 0;
+timepoint progress_start_t = 0;
+std::chrono::steady_clock::time_point progress_start_time, last_progress_time;
+
+/** Start measuring progress (at the start of the simulation loop).
+ */
+void init_progress ()
+{
+    progress_start_time = last_progress_time = std::chrono::steady_clock::now();
+    progress_start_n_events = last_progress_n_events = n_events;
+    progress_start_t = current_t;
+    next_progress_n_events = (progress_n_events < LONG_MAX) ? (n_events / progress_n_events + 1) * progress_n_events : LONG_MAX;
+    // in verbose mode, the state is already logged for each event:
+    next_progress_check = (silent || verbose) ? LONG_MAX : min(n_events + PROGRESS_CHECK_EVENTS, next_progress_n_events);
+}
+
+/** \returns a duration formatted as h:mm:ss
+ */
+string hms (double seconds)
+{
+    long int s = lround(seconds);
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%ld:%02ld:%02ld", s / 3600, (s / 60) % 60, s % 60);
+    return buf;
+}
+
+/** Log the state with events per second and estimated remaining wall time
+ *  if \ref progress_seconds have passed or \ref progress_n_events have happened since the last progress line.
+ *
+ *  Only called every \ref PROGRESS_CHECK_EVENTS events, so that the simulation loop does not read the clock each time.
+ */
+void log_progress ()
+{
+    auto now = std::chrono::steady_clock::now();
+    double since_last = std::chrono::duration<double>(now - last_progress_time).count();
+    if ((n_events >= next_progress_n_events) || (since_last >= progress_seconds)) {
+        double elapsed = std::chrono::duration<double>(now - progress_start_time).count();
+        // fraction done w.r.t. the event limit or the time limit, whichever is further:
+        double done = 0;
+        if (max_n_events < LONG_MAX) done = (double) (n_events - progress_start_n_events) / (max_n_events - progress_start_n_events);
+        if (max_t < INFINITY) done = max(done, (current_t - progress_start_t) / (max_t - progress_start_t));
+        char buf[64];
+        snprintf(buf, sizeof(buf), " | %.0f ev/s, RSS %.0f MB, ETA ", (n_events - last_progress_n_events) / since_last, rss_mb());
+        log_state(buf + ((done > 0) ? hms(elapsed * (1 - done) / done) : "?"));
+        last_progress_time = now;
+        last_progress_n_events = n_events;
+        while (next_progress_n_events <= n_events) next_progress_n_events += progress_n_events;
+    }
+    next_progress_check = min(n_events + PROGRESS_CHECK_EVENTS, next_progress_n_events);
+}
+
+/** \returns the no. of events and events per second since \ref init_progress, for the final log line
+ */
+string progress_summary ()
+{
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - progress_start_time).count();
+    char buf[128];
+    snprintf(buf, sizeof(buf), " | %ld events in %.1f s, %.0f ev/s, peak RSS %.0f MB",
+            n_events - progress_start_n_events, elapsed, (n_events - progress_start_n_events) / max(elapsed, 1e-9), peak_rss_mb());
+    return buf;
+}
+
+/** A field of a csv row, usually pointing directly into the mapped file.
+ */
+struct csv_field
+{
+    std::string_view text = {};  ///< content without quotes
+    long int id = -1;            ///< if the content is a non-negative integer without leading zeros, its value, otherwise -1
+};
+
+enum csv_role { CR_E1, CR_ET1, CR_RAT13, CR_E3, CR_ET3, N_CSV_ROLES };  ///< Roles of the columns that are read
+
+typedef std::array<csv_field, N_CSV_ROLES> csv_row;
+
+/** Tokenize the complete lines in text[begin...end) and append the needed fields of each row to rows.
+ *
+ *  Fields may be quoted with ", in which case they may contain the delimiter and
+ *  doubled quotes (but no line breaks). Line ends may be \n or \r\n, empty lines are ignored.
+ *
+ *  \returns "" or an error message
+ */
+string tokenize_csv (
+        const char* text,             ///< [in] the mapped file
+        size_t begin,                 ///< [in] position of the first line start
+        size_t end,                   ///< [in] position after the last line end
+        char delimiter,               ///< [in] delimiter
+        const vector<int>& col2role,  ///< [in] role of each column, or -1 if it is not needed
+        vector<csv_row>& rows,        ///< [out] tokenized rows
+        std::deque<string>& unquoted  ///< [out] storage for fields that contained doubled quotes
+        )
+{
+    size_t n_cols = col2role.size();
+    auto p = text + begin, stop = text + end;
+    while (p < stop) {
+        if ((*p == '\n') || ((*p == '\r') && (p + 1 < stop) && (p[1] == '\n'))) {  // empty line
+            p += (*p == '\n') ? 1 : 2;
+            continue;
+        }
+        csv_row row;
+        size_t col = 0;
+        while (true) {
+            std::string_view field;  // (empty if the row ends with a delimiter at the end of the file)
+            if ((p < stop) && (*p == '"')) {
+                auto q = ++p;
+                bool doubled = false;
+                while ((q < stop) && ((*q != '"') || ((q + 1 < stop) && (q[1] == '"')))) {
+                    if (*q == '\n') return "line break in quoted csv field";
+                    if (*q == '"') { doubled = true; q++; }
+                    q++;
+                }
+                if (q == stop) return "unterminated quoted csv field";
+                field = std::string_view(p, q - p);
+                if (doubled) {
+                    string s;
+                    for (size_t i = 0; i < field.size(); i++) {
+                        s += field[i];
+                        if (field[i] == '"') i++;
+                    }
+                    unquoted.push_back(s);
+                    field = unquoted.back();
+                }
+                p = q + 1;
+            } else {
+                auto q = p;
+                while ((q < stop) && (*q != delimiter) && (*q != '\n')) q++;
+                field = std::string_view(p, ((q > p) && (q[-1] == '\r') && ((q == stop) || (*q == '\n'))) ? q - p - 1 : q - p);
+                p = q;
+            }
+            if ((col < n_cols) && (col2role[col] >= 0)) {
+                auto& f = row[col2role[col]];
+                f.text = field;
+                // numeric labels:
+                if ((field.size() > 0) && (field.size() < 19) && ((field[0] != '0') || (field.size() == 1))) {
+                    long int id = 0;
+                    for (auto c : field) {
+                        if ((c < '0') || (c > '9')) { id = -1; break; }
+                        id = id * 10 + (c - '0');
+                    }
+                    f.id = id;
+                }
+            }
+            col++;
+            if ((p < stop) && (*p == '\r')) p++;
+            if ((p == stop) || (*p == '\n')) break;
+            if (*p != delimiter) return "unexpected character after quoted csv field";
+            p++;
+        }
+        if (p < stop) p++;  // skip line break
+        if (col < n_cols) return "csv row has only " + to_string(col) + " columns";
+        rows.push_back(row);
     }
+    return "";
 }
 
 /** Read initial links from a csv file.
@@ -123,6 +294,11 @@ void log_state ()
  *  Entity labels from the file are prefixed by e_prefix before storing them in tricl,
  *  e.g. the file might contain label "1" and you want it to be treated as "agent 1",
  *  so put e1_prefix = "agent ";
+ *
+ *  The file is memory-mapped and processed in batches of \ref CSV_BATCH_BYTES bytes.
+ *  Each batch is tokenized in parallel (without copying labels),
+ *  then its rows are resolved in order, so that new entities get the same ids
+ *  as when reading row by row. Numeric labels are resolved via a lookup table.
  */
 void read_links_csv (
         string filename,    ///< [in] name of infile
@@ -144,68 +320,156 @@ void read_links_csv (
         entity_type et3_default  ///< [in] default entity-type for previously unregistered e3s (if -1, no new e3s are allowed or et3_col is used instead)
         )
 {
-    rapidcsv::Document doc(filename,
-            rapidcsv::LabelParams(-1, -1), // access all rows and cols
-            rapidcsv::SeparatorParams(delimiter)
-        );
-
-    auto e1labels = doc.GetColumn<string>(e1_col);
-    auto e3labels = doc.GetColumn<string>(e3_col);
-    int nrows = e1labels.size();
-    vector<string> et1labels, rat13labels, et3labels;
-    if (et1_col > -1) et1labels = doc.GetColumn<string>(et1_col);
-    if (rat13_col > -1) rat13labels = doc.GetColumn<string>(rat13_col);
-    if (et3_col > -1) et3labels = doc.GetColumn<string>(et3_col);
-    for (int row = skip_rows; row < min(nrows, skip_rows+max_rows); row++) {
-        if (debug) cout << "row " << row << " " << e1labels[row] << " " << e3labels[row] << endl;
-        auto e1label = e1_prefix + e1labels[row], e3label = e3_prefix + e3labels[row];
-        entity_type et1, et3;
-        entity e1, e3;
-
-        // get and verify et1:
-        if (label2e.count(e1label) == 0)
+    // map file into memory:
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd == -1) throw "cannot open csv file " + filename;
+    struct stat st;
+    if (fstat(fd, &st) == -1) { close(fd); throw "cannot read csv file " + filename; }
+    size_t size = st.st_size;
+    if (size == 0) { close(fd); return; }
+    auto text = (const char*) mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (text == MAP_FAILED) throw "cannot map csv file " + filename;
+    madvise((void*) text, size, MADV_SEQUENTIAL);
+
+    // which columns are needed for what:
+    vector<int> col2role;
+    for (auto [col, role] : { pair<int, int>{ e1_col, CR_E1 }, { et1_col, CR_ET1 }, { rat13_col, CR_RAT13 }, { e3_col, CR_E3 }, { et3_col, CR_ET3 } }) {
+        if (col > -1) {
+            if ((int) col2role.size() <= col) col2role.resize(col + 1, -1);
+            col2role[col] = role;
+        }
+    }
+
+    // lookup tables for numeric labels, by role (shared if prefixes are equal):
+    vector<entity> id2e1, id2e3_own;
+    auto& id2e3 = (e3_prefix == e1_prefix) ? id2e1 : id2e3_own;
+
+    // get or add the entity of a row:
+    auto resolve = [&](const csv_field& f, const string& prefix, vector<entity>& id2e, const csv_field& etf, entity_type et_default, const string& which) {
+        bool cached = (f.id >= 0) && (f.id < CSV_MAX_ID);
+        if (cached && ((size_t) f.id < id2e.size()) && (id2e[f.id] != 0) && (etf.text.size() == 0)) return id2e[f.id];
+        auto elabel = prefix + string(f.text);
+        string etlabel(etf.text);
+        entity e;
+        if (label2e.count(elabel) == 0)
         {
-            if ((et1_col > -1) && (et1labels[row] != "")) {
-                if (label2et.count(et1labels[row])) et1 = label2et.at(et1labels[row]);
-                else throw "unknown et1 label " + et1labels[row];
+            entity_type et;
+            if (etlabel != "") {
+                if (label2et.count(etlabel)) et = label2et.at(etlabel);
+                else throw "unknown " + which + " label " + etlabel;
             }
-            else if (et1_default != -1) et1 = et1_default;
-            else throw "cannot determine entity type for " + e1label;
-            e1 = add_entity(et1, e1label);
-            if (verbose) cout << "  entity " << e1 << ": " << et2label.at(et1) << ": " << e1label << endl;
+            else if (et_default != -1) et = et_default;
+            else throw "cannot determine entity type for " + elabel;
+            e = add_entity(et, elabel);
+            if (verbose) cout << "  entity " << e << ": " << et2label.at(et) << ": " << elabel << endl;
         }
         else
         {
-            e1 = label2e.at(e1label);
-            et1 = e2et[e1];
-            if ((et1_col > -1) && (et1labels[row] != "") && (et1labels[row] != et2label[et1])) throw
-                    "wrong et1 label " + et1labels[row] + " for known entity " + e1label;
+            e = label2e.at(elabel);
+            if ((etlabel != "") && (etlabel != et2label[e2et[e]])) throw
+                    "wrong " + which + " label " + etlabel + " for known entity " + elabel;
+        }
+        if (cached) {
+            if ((size_t) f.id >= id2e.size()) id2e.resize(min((size_t) CSV_MAX_ID, max(2 * id2e.size(), (size_t) f.id + 1)), 0);
+            id2e[f.id] = e;
         }
+        return e;
+    };
 
-        // get and verify et3:
-        if (label2e.count(e3label) == 0)
-        {
-            if ((et3_col > -1) && (et3labels[row] != "")) {
-                if (label2et.count(et3labels[row])) et3 = label2et.at(et3labels[row]);
-                else throw "unknown et3 label " + et3labels[row];
+    vector<vector<csv_row>> chunk2rows(n_threads);
+    vector<std::deque<string>> chunk2unquoted(n_threads);
+    vector<string> chunk2error(n_threads);
+    long int row = 0, last_row = (long int) skip_rows + max_rows;
+    // returns the first line start at or after pos:
+    auto line_start = [&](size_t pos) {
+        while ((pos > 0) && (pos < size) && (text[pos - 1] != '\n')) pos++;
+        return min(pos, size);
+    };
+    // (the mapping is released on all paths, also if resolving a row throws:)
+    try {
+        for (size_t batch_begin = 0; (batch_begin < size) && (row < last_row); ) {
+            size_t batch_end = line_start(min(size, batch_begin + CSV_BATCH_BYTES));
+            // tokenize batch in parallel:
+            parallel_for(batch_end - batch_begin, [&](unsigned chunk, size_t begin, size_t end) {
+                chunk2rows[chunk].clear();
+                chunk2unquoted[chunk].clear();
+                chunk2error[chunk] = tokenize_csv(text, line_start(batch_begin + begin), line_start(batch_begin + end),
+                        delimiter, col2role, chunk2rows[chunk], chunk2unquoted[chunk]);
+            });
+            // resolve rows in order:
+            for (unsigned chunk = 0; chunk < n_threads; chunk++) {
+                if (chunk2error[chunk] != "") throw chunk2error[chunk] + " in " + filename;
+                for (auto& r : chunk2rows[chunk]) {
+                    if (row >= last_row) break;
+                    if (row++ < skip_rows) continue;
+                    if (debug) cout << "row " << row - 1 << " " << r[CR_E1].text << " " << r[CR_E3].text << endl;
+                    entity e1 = resolve(r[CR_E1], e1_prefix, id2e1, r[CR_ET1], et1_default, "et1"),
+                           e3 = resolve(r[CR_E3], e3_prefix, id2e3, r[CR_ET3], et3_default, "et3");
+                    if (debug) cout << e1 << " " << e3 << endl;
+                    auto rat13 = (rat13_col >= 0) ? label2rat.at(string(r[CR_RAT13].text)) : rat13_fixed;
+                    if (debug) cout << rat13 << endl;
+                    initial_links.push_back({ e1, rat13, e3 });
+                }
+                chunk2rows[chunk].clear();
+                chunk2error[chunk] = "";
             }
-            else if (et3_default != -1) et3 = et3_default;
-            else throw "cannot determine entity type for " + e3label;
-            e3 = add_entity(et3, e3label);
-            if (verbose) cout << "  entity " << e3 << ": " << et2label.at(et3) << ": " << e3label << endl;
-        }
-        else
-        {
-            e3 = label2e.at(e3label);
-            et3 = e2et[e3];
-            if ((et3_col > -1) && (et3labels[row] != "") && (et3labels[row] != et2label[et3])) throw
-                    "wrong et3 label " + et3labels[row] + " for known entity " + e3label;
+            batch_begin = batch_end;
         }
-        if (debug) cout << e1 << " " << e3 << endl;
-        auto rat13 = (rat13_col >= 0) ? label2rat.at(rat13labels[row]) : rat13_fixed;
-        if (debug) cout << rat13 << endl;
-        initial_links.insert({ e1, rat13, e3 });
     }
+    catch (...) {
+        munmap((void*) text, size);
+        throw;
+    }
+    munmap((void*) text, size);
+}
+
+/** \returns s quoted for csv if necessary
+ */
+string csv_quoted (const string& s)
+{
+    if (s.find_first_of(",\"\n") == string::npos) return s;
+    string r = "\"";
+    for (char c : s) {
+        if (c == '"') r += "\"\"";
+        else r += c;
+    }
+    return r + "\"";
+}
+
+/** Insert a suffix into a filename before its extension
+ *  (before ".gexf" for gexf and gexf.gz files, so that the file type is kept).
+ *
+ *  \returns the new filename
+ */
+string filename_with_suffix (
+        const string& filename,  ///< [in] original name of (or path to) file
+        const string& suffix     ///< [in] suffix to insert
+        )
+{
+    auto pos = filename.rfind(".gexf");
+    if (pos == string::npos) {
+        pos = filename.rfind('.');
+        auto slash_pos = filename.rfind('/');
+        if ((pos == string::npos) || ((slash_pos != string::npos) && (pos < slash_pos))) pos = filename.size();
+    }
+    return filename.substr(0, pos) + suffix + filename.substr(pos);
+}
+
+/** Insert a suffix into the names of all gexf, tlog and metrics output files (see \ref filename_with_suffix).
+ */
+void add_output_filename_suffix (
+        const string& suffix  ///< [in] suffix to insert
+        )
+{
+    for (auto& [rat13, fn] : gexf_filename) {
+        if (fn != "") fn = filename_with_suffix(fn, suffix);
+    }
+    unordered_map<string, string> old_compression;
+    old_compression.swap(gexf_compression);
+    for (auto& [fn, cm] : old_compression) gexf_compression[filename_with_suffix(fn, suffix)] = cm;
+    if (tlog_filename != "") tlog_filename = filename_with_suffix(tlog_filename, suffix);
+    if (metrics_filename != "") metrics_filename = filename_with_suffix(metrics_filename, suffix);
 }
 
 /** (for debugging purposes)
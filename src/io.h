@@ -2,7 +2,7 @@
 #ifndef INC_IO_H
 #define INC_IO_H
 
-#include "data_model.h"
+#include "global_variables.h"
 
 namespace tricl {
 
@@ -20,7 +20,24 @@ ostream& operator<< (ostream& os, const event_data& evd);
 
 using tricl::operator<<;
 
-void log_state ();
+#define PROGRESS_CHECK_EVENTS 1024  ///< No. of events between checks whether a progress line is due
+
+extern long int next_progress_check;
+
+void log_state (const string& progress = "");
+
+void init_progress ();
+
+void log_progress ();
+
+/** Log progress if due (cheap enough to be called after each event).
+ */
+inline void log_progress_if_due ()
+{
+    if (n_events >= next_progress_check) log_progress();
+}
+
+string progress_summary ();
 
 void read_links_csv (
         string filename,
@@ -42,6 +59,11 @@ void read_links_csv (
         entity_type et3_default
         );
 
+string csv_quoted (const string& s);
+
+string filename_with_suffix (const string& filename, const string& suffix);
+void add_output_filename_suffix (const string& suffix);
+
 void dump_links ();
 
 void dump_data ();
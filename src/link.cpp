@@ -9,6 +9,7 @@
 #include "probability.h"
 #include "event.h"
 #include "gexf.h"
+#include "tlog.h"
 #include "link.h"
 
 /** \returns whether link currently exists.
@@ -28,13 +29,14 @@ void add_link (tricllink& l)
     auto et1 = e2et[e1], et3 = e2et[e3];
 
     // keep inleg and outleg sets consistent:
-    e2outs[e1].insert({ .rat_out = rat13, .e_target = e3 });
+    // (the outleg also registers the birth time for later output)
+    e2outs[e1].insert({ .rat_out = rat13, .e_target = e3, .t_start = current_t });
     e2ins[e3].insert({ .e_source = e1, .rat_in = rat13 });
 
-    // register birth time for later output:
-    if (rat13 != RT_ID) gexf_edge2start[l] = current_t;
+    if (tlog_active && (rat13 != RT_ID)) tlog_output_link_event(EC_EST, l);
 
     // update counts:
+    change_summary_coverage(e1, rat13, e3, -1);
     lt2n[{et1, rat13, et3}]++;
     n_links++;
 }
@@ -48,27 +50,19 @@ void delete_link (tricllink& l)
     auto et1 = e2et[e1], et3 = e2et[e3];
 
     // keep inleg and outleg sets consistent:
-    e2outs[e1].erase({ .rat_out = rat13, .e_target = e3 });
+    auto& outs = e2outs[e1];
+    auto it = outs.find({ .rat_out = rat13, .e_target = e3 });
+    if (it == outs.end()) throw "deleting a missing link";
+    auto t_start = it->t_start;
+    outs.erase(it);
     e2ins[e3].erase({ .e_source = e1, .rat_in = rat13 });
 
-    // output to gexf:
-    if (rat13 != RT_ID) gexf_output_edge(l);
+    // output to gexf and tlog:
+    if (rat13 != RT_ID) gexf_output_edge(l, t_start);
+    if (tlog_active && (rat13 != RT_ID)) tlog_output_link_event(EC_TERM, l);
 
     // update counts:
+    change_summary_coverage(e1, rat13, e3, 1);
     lt2n[{et1, rat13, et3}]--;
     n_links--;
 }
-
-/** perform an event that generates a random link during installation.
- */
-void do_random_link (probability p, entity e1, relationship_or_action_type rat13, entity e3) {
-    if (uniform(random_variable) < p) {
-        tricllink l = { e1, rat13, e3 };
-        if (!link_exists(l)) {
-            event ev = { .ec=EC_EST, e1, rat13, e3 };
-            conditionally_remove_event(ev);
-            // prepair total effective rate since call to perform_event will subtracted INFINITY from it:
-            perform_event(ev, &sure_evd);
-        }
-    }
-}
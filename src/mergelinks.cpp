@@ -0,0 +1,394 @@
+/** tricl_mergelinks, a post-processor merging all edges of the same link in a gexf file into one edge with spells
+ *
+ *  \file
+ *
+ *  Usage: ``tricl_mergelinks input.gexf[.gz] output.gexf[.gz] [options]``
+ *
+ *  tricl writes one edge per time interval at which a link existed, in the order in which the intervals end.
+ *  Since gephi cannot merge these edges per relationship or action type (see \ref gexf.cpp),
+ *  this tool sorts all edges by the comment key ``<!--e1_rat_e3_n-->`` that tricl puts in front of each edge
+ *  and writes one edge per link (e1, rat, e3), whose time intervals are given as ``<spells>``
+ *  and whose "S" and "E" attributes have one value per spell.
+ *
+ *  Since inputs may be much larger than memory, this is an external sort:
+ *  - the input is read in chunks of at most (memory budget)/(threads + 1) bytes,
+ *    each chunk is sorted and written to a temporary run file by a separate thread
+ *    while the next chunk is being read;
+ *  - if there are more runs than the fan-in, groups of runs are merged in parallel into longer runs;
+ *  - the remaining runs are merged into the output file, which is gzip-compressed in parallel if it ends with .gz.
+ *
+ *  Memory use is thus bounded by the budget plus one read buffer per run,
+ *  plus the spells of the link currently being written.
+ */
+
+#include <unistd.h>
+#include <stdio.h>
+#include <zlib.h>
+#include <algorithm>
+#include <future>
+#include <queue>
+#include <tuple>
+#include <thread>
+
+#include "global_variables.h"
+#include "sink.h"
+#include "3rdparty/cxxopts.hpp"
+
+#define MERGELINKS_READ_BUFFER_BYTES (1<<18)  ///< Buffer size for reading input and run files
+#define MERGELINKS_RUN_COMPRESSION_LEVEL 1    ///< zlib level for temporary run files (fast, since they are read only once)
+
+/** Reads a plain or gzip-compressed file line by line (without the trailing newline).
+ */
+class line_reader
+{
+    gzFile f;
+    string buf;
+    size_t pos = 0, end = 0;
+    bool eof = false;
+
+public:
+    line_reader (const string& filename)
+    {
+        f = gzopen(filename.c_str(), "rb");  // (also reads uncompressed files)
+        if (f == NULL) throw "cannot open file for reading";
+        gzbuffer(f, MERGELINKS_READ_BUFFER_BYTES);
+        buf.resize(MERGELINKS_READ_BUFFER_BYTES);
+    }
+    ~line_reader () { gzclose(f); }
+    line_reader (const line_reader&) = delete;
+
+    /** \returns whether a line was read into line
+     */
+    bool get (string& line)
+    {
+        line.clear();
+        while (true) {
+            if (pos == end) {
+                if (eof) return !line.empty();
+                int n = gzread(f, buf.data(), buf.size());
+                if (n < 0) throw "cannot read file (truncated or corrupt?)";
+                if (n == 0) {
+                    eof = true;
+                    continue;
+                }
+                pos = 0;
+                end = n;
+            }
+            auto nl = (const char*) memchr(buf.data() + pos, '\n', end - pos);
+            if (nl == NULL) {
+                line.append(buf.data() + pos, end - pos);
+                pos = end;
+            } else {
+                line.append(buf.data() + pos, nl - (buf.data() + pos));
+                pos = nl - buf.data() + 1;
+                return true;
+            }
+        }
+    }
+};
+
+/** Declare the "S" and "E" edge attributes in a header line as dynamic, since merged edges have one value of each per spell.
+ *
+ *  (They are the last attributes of the edge attributes block in the headers written by tricl and tricl_convert.)
+ */
+void make_spell_attributes_dynamic (string& line)
+{
+    auto pos = line.find("<attribute id=\"S\"");
+    if (pos != string::npos) line.insert(pos, "</attributes><attributes class=\"edge\" mode=\"dynamic\">");
+}
+
+/** The sort key of an edge, parsed from its comment ``<!--e1_rat_e3_n-->``.
+ */
+struct edge_key
+{
+    int64_t e1;
+    uint64_t rat13;
+    int64_t e3;
+    int64_t n;  ///< no. of events when the edge was written (orders the edges of a link chronologically)
+
+    bool same_link (const edge_key& o) const { return (e1 == o.e1) && (rat13 == o.rat13) && (e3 == o.e3); }
+    friend bool operator< (const edge_key& a, const edge_key& b) {
+        return std::tie(a.e1, a.rat13, a.e3, a.n) < std::tie(b.e1, b.rat13, b.e3, b.n);
+    }
+};
+
+/** Parse the key of an edge line.
+ *
+ *  \returns whether the line is an edge line with a key
+ */
+bool parse_edge_key (const string& line, edge_key& k)
+{
+    if ((line.compare(0, 4, "<!--") != 0) || (line.size() < 5) || !isdigit(line[4])) return false;
+    const char* p = line.c_str() + 4;
+    char* q;
+    k.e1 = strtoll(p, &q, 10);
+    if (*q != '_') return false;
+    k.rat13 = strtoull(q + 1, &q, 10);
+    if (*q != '_') return false;
+    k.e3 = strtoll(q + 1, &q, 10);
+    if (*q != '_') return false;
+    k.n = strtoll(q + 1, &q, 10);
+    return (*q == '-');
+}
+
+/** \returns the value of xml attribute name (given as e.g. " start=\"") in line after position from, or "" if missing
+ */
+string_view xml_attribute (const string& line, const char* name, size_t from = 0)
+{
+    auto pos = line.find(name, from);
+    if (pos == string::npos) return string_view();
+    pos += strlen(name);
+    auto end = line.find('"', pos);
+    if (end == string::npos) return string_view();
+    return string_view(line.data() + pos, end - pos);
+}
+
+/** A sorted chunk of edges in memory.
+ */
+struct edge_chunk
+{
+    string text;                          ///< all lines, each terminated by a newline
+    vector<pair<edge_key, size_t>> refs;  ///< key and position in text of each line
+};
+
+/** Sort a chunk and write it to a run file.
+ */
+void write_run (
+        edge_chunk* chunk,       ///< [in] the chunk (will be deleted)
+        const string& filename   ///< [in] name of run file
+        )
+{
+    std::sort(chunk->refs.begin(), chunk->refs.end(),
+            [](const pair<edge_key, size_t>& a, const pair<edge_key, size_t>& b) { return a.first < b.first; });
+    gzFile f = gzopen(filename.c_str(), ("wb" + to_string(MERGELINKS_RUN_COMPRESSION_LEVEL)).c_str());
+    if (f == NULL) throw "cannot write temporary run file";
+    gzbuffer(f, MERGELINKS_READ_BUFFER_BYTES);
+    const char* text = chunk->text.data();
+    for (auto& [k, pos] : chunk->refs) {
+        auto nl = (const char*) memchr(text + pos, '\n', chunk->text.size() - pos);
+        if (gzwrite(f, text + pos, nl + 1 - (text + pos)) == 0) throw "cannot write temporary run file (disk full?)";
+    }
+    if (gzclose(f) != Z_OK) throw "cannot write temporary run file (disk full?)";
+    delete chunk;
+}
+
+/** Merges sorted run files, calling f(key, line) for each edge line in sorted order.
+ */
+template <typename F>
+void merge_runs (
+        const vector<string>& filenames,  ///< [in] run files to merge
+        F f                               ///< [in] function (const edge_key&, const string&) to call for each edge
+        )
+{
+    vector<std::unique_ptr<line_reader>> readers;
+    vector<string> lines(filenames.size());
+    vector<edge_key> keys(filenames.size());
+    auto later = [&keys](size_t a, size_t b) { return keys[b] < keys[a]; };
+    std::priority_queue<size_t, vector<size_t>, decltype(later)> heads(later);
+    for (size_t i = 0; i < filenames.size(); i++) {
+        readers.emplace_back(new line_reader(filenames[i]));
+        if (readers[i]->get(lines[i])) {
+            if (!parse_edge_key(lines[i], keys[i])) throw "corrupt temporary run file";
+            heads.push(i);
+        }
+    }
+    while (!heads.empty()) {
+        auto i = heads.top();
+        heads.pop();
+        f(keys[i], lines[i]);
+        if (readers[i]->get(lines[i])) {
+            if (!parse_edge_key(lines[i], keys[i])) throw "corrupt temporary run file";
+            heads.push(i);
+        }
+    }
+}
+
+/** Collects all edges of one link and writes them as one edge with spells.
+ */
+class link_merger
+{
+    output_sink& out;
+    edge_key first_key;
+    size_t n_spells = 0;
+    string head;    ///< edge element up to and incl. the R attribute value
+    string svals;   ///< S and E attribute values, one per spell
+    string spells;  ///< spell elements
+    string tail;    ///< visualization elements
+
+public:
+    link_merger (output_sink& o) : out(o) {}
+
+    void add (const edge_key& k, const string& line)
+    {
+        if ((n_spells > 0) && !k.same_link(first_key)) flush();
+        auto start = xml_attribute(line, " start=\""), end = xml_attribute(line, " end=\"");
+        if (n_spells == 0) {
+            first_key = k;
+            auto id = to_string(k.e1) + "_" + to_string(k.rat13) + "_" + to_string(k.e3);
+            head = "<!--" + id + "--> <edge id=\"" + id + "\" source=\"" + string(xml_attribute(line, " source=\""))
+                    + "\" target=\"" + string(xml_attribute(line, " target=\""))
+                    + "\"><attvalues><attvalue for=\"R\" value=\"" + string(xml_attribute(line, "<attvalue for=\"R\" value=\"")) + "\"/>";
+            auto pos = line.find("</attvalues>");
+            auto end_pos = line.rfind("</edge>");
+            tail = ((pos != string::npos) && (end_pos != string::npos) && (end_pos > pos + 12))
+                    ? line.substr(pos + 12, end_pos - pos - 12) : "";
+        }
+        svals.append("<attvalue for=\"S\" value=\"").append(start).append("\" start=\"").append(start)
+             .append("\" end=\"").append(end).append("\"/><attvalue for=\"E\" value=\"").append(end)
+             .append("\" start=\"").append(start).append("\" end=\"").append(end).append("\"/>");
+        spells.append("<spell start=\"").append(start).append("\" end=\"").append(end).append("\"/>");
+        n_spells++;
+    }
+
+    void flush ()
+    {
+        if (n_spells == 0) return;
+        out << head << svals << "</attvalues><spells>" << spells << "</spells>" << tail << "</edge>\n";
+        svals.clear();
+        spells.clear();
+        n_spells = 0;
+    }
+};
+
+int main (int argc, char *argv[])
+{
+    vector<string> run_filenames;
+    try
+    {
+        cxxopts::Options options("tricl_mergelinks", "merge all edges of each link in a tricl gexf file into one edge with spells");
+        options.add_options()
+                ("help", "Print help")
+                ("input", "input file (.gexf or .gexf.gz written by tricl)", cxxopts::value<string>())
+                ("output", "output file (.gexf or .gexf.gz)", cxxopts::value<string>())
+                ("memory", "memory budget for sorting in MB", cxxopts::value<size_t>()->default_value("1024"))
+                ("threads", "no. of threads (0: all hardware threads)", cxxopts::value<unsigned>()->default_value("0"))
+                ("tmp", "folder for temporary files (default: that of the output file)", cxxopts::value<string>()->default_value(""))
+                ("fan-in", "max. no. of runs merged at once", cxxopts::value<size_t>()->default_value("256"))
+                ;
+        options.parse_positional({ "input", "output" });
+        options.positional_help("input.gexf[.gz] output.gexf[.gz]");
+        auto opts = options.parse(argc, argv);
+        if ((opts.count("help") > 0) || (opts.count("input") == 0) || (opts.count("output") == 0)) {
+            cout << options.help() << endl;
+            return (opts.count("help") > 0) ? 0 : 1;
+        }
+        string in_filename = opts["input"].as<string>(), out_filename = opts["output"].as<string>();
+        bool is_gz = (out_filename.size() > 3) && (out_filename.substr(out_filename.size() - 3) == ".gz");
+        string stem = is_gz ? out_filename.substr(0, out_filename.size() - 3) : out_filename;
+        if ((stem.size() <= 5) || (stem.substr(stem.size() - 5) != ".gexf")) throw "output file must end with .gexf or .gexf.gz";
+        n_threads = opts["threads"].as<unsigned>();
+        if (n_threads == 0) n_threads = max(1u, std::thread::hardware_concurrency());
+        size_t chunk_bytes = (opts["memory"].as<size_t>() << 20) / (n_threads + 1);
+        size_t fan_in = max((size_t)2, opts["fan-in"].as<size_t>());
+        string tmp_prefix = opts["tmp"].as<string>();
+        if (tmp_prefix == "") {
+            auto slash_pos = out_filename.rfind('/');
+            tmp_prefix = (slash_pos == string::npos) ? "." : out_filename.substr(0, slash_pos);
+        }
+        tmp_prefix += "/tricl_mergelinks_" + to_string(getpid()) + "_";
+        auto new_run_filename = [&]() {
+            run_filenames.push_back(tmp_prefix + to_string(run_filenames.size()) + ".run.gz");
+            return run_filenames.back();
+        };
+
+        // read input, write header, and write sorted runs in parallel:
+        output_sink out(out_filename, is_gz ? CM_PARALLEL_GZIP : CM_NONE);
+        line_reader in(in_filename);
+        vector<string> runs;
+        std::deque<std::future<void>> writing;
+        auto chunk = new edge_chunk();
+        auto hand_over_chunk = [&]() {
+            if (writing.size() >= n_threads) {
+                writing.front().get();
+                writing.pop_front();
+            }
+            runs.push_back(new_run_filename());
+            writing.push_back(std::async(std::launch::async, write_run, chunk, runs.back()));
+            chunk = new edge_chunk();
+        };
+        string line, footer = "";
+        edge_key k;
+        bool in_edges = false;
+        long int n_edges = 0;
+        while (in.get(line)) {
+            if (!in_edges) {
+                // header, possibly followed by the first edge or the footer in the same line:
+                make_spell_attributes_dynamic(line);
+                auto pos = line.find("<edges>");
+                if (pos == string::npos) {
+                    out << line << '\n';
+                    continue;
+                }
+                out << string_view(line.data(), pos + 7);
+                line.erase(0, pos + 7);
+                in_edges = true;
+                if (line.empty()) continue;
+            }
+            if (line.compare(0, 8, "<!--Z-->") == 0) {
+                footer = line;
+            } else if (parse_edge_key(line, k)) {
+                chunk->refs.push_back({ k, chunk->text.size() });
+                chunk->text.append(line).push_back('\n');
+                n_edges++;
+                if (chunk->text.size() + chunk->refs.size() * sizeof(pair<edge_key, size_t>) >= chunk_bytes) hand_over_chunk();
+            } else throw "input contains edges without <!--e1_rat_e3_n--> key (only gexf files written by tricl or tricl_convert are supported)";
+        }
+        if (!in_edges || (footer == "")) throw "input is not a complete gexf file written by tricl";
+        if (!chunk->refs.empty()) hand_over_chunk();
+        delete chunk;
+        for (auto& w : writing) w.get();
+        cout << n_edges << " edges sorted into " << runs.size() << " runs." << endl;
+
+        // reduce the no. of runs by merging groups of runs in parallel:
+        while (runs.size() > fan_in) {
+            vector<string> merged;
+            vector<std::future<void>> merging;
+            for (size_t i = 0; i < runs.size(); i += fan_in) {
+                vector<string> group(runs.begin() + i, runs.begin() + min(i + fan_in, runs.size()));
+                merged.push_back(new_run_filename());
+                merging.push_back(std::async(std::launch::async, [group, fn = merged.back()]() {
+                    gzFile f = gzopen(fn.c_str(), ("wb" + to_string(MERGELINKS_RUN_COMPRESSION_LEVEL)).c_str());
+                    if (f == NULL) throw "cannot write temporary run file";
+                    gzbuffer(f, MERGELINKS_READ_BUFFER_BYTES);
+                    merge_runs(group, [f](const edge_key&, const string& line) {
+                        if ((gzwrite(f, line.data(), line.size()) == 0) || (gzputc(f, '\n') == -1)) throw
+                                "cannot write temporary run file (disk full?)";
+                    });
+                    if (gzclose(f) != Z_OK) throw "cannot write temporary run file (disk full?)";
+                    for (auto& r : group) unlink(r.c_str());
+                }));
+                // (at most n_threads merges at a time:)
+                if (merging.size() % n_threads == 0) for (auto& m : merging) if (m.valid()) m.get();
+            }
+            for (auto& m : merging) if (m.valid()) m.get();
+            runs = merged;
+        }
+
+        // final merge into the output file:
+        link_merger merger(out);
+        long int n_links = 0;
+        edge_key last_key = { 0, 0, 0, 0 };
+        merge_runs(runs, [&](const edge_key& k, const string& line) {
+            if ((n_links == 0) || !k.same_link(last_key)) n_links++;
+            last_key = k;
+            merger.add(k, line);
+        });
+        merger.flush();
+        out << footer << '\n';
+        out.close();
+        for (auto& r : run_filenames) unlink(r.c_str());
+        cout << n_edges << " edges merged into " << n_links << " links." << endl;
+    }
+    catch (const char* msg)
+    {
+        for (auto& r : run_filenames) unlink(r.c_str());
+        cerr << "ERROR: exiting with message: " << msg << endl;
+        return 1;
+    }
+    catch (const cxxopts::OptionException& e)
+    {
+        cerr << "ERROR: " << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
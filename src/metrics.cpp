@@ -0,0 +1,122 @@
+/** Output of time series of aggregate statistics to a csv (or csv.gz) file.
+ *
+ *  \file
+ *
+ *  Each row contains model time, no. of events, no. of links, no. of angles,
+ *  total finite effective rate, cumulative log-likelihood,
+ *  and the no. of links of each link type (as in the log output, inverse link types are omitted).
+ *  Rows are written at all multiples of \ref metrics_dt (with the state at that time,
+ *  i.e., after all events up to and including that time), after every \ref metrics_n_events events,
+ *  and at the end of the run.
+ *
+ *  The simulation loop only compares the next event's time and the no. of events to the next sampling point,
+ *  and rows go through the large buffer of an \ref output_sink.
+ */
+
+#include <limits.h>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <tuple>
+
+#include "global_variables.h"
+#include "io.h"
+#include "sink.h"
+#include "metrics.h"
+
+timepoint next_metrics_t = INFINITY;       ///< Next multiple of \ref metrics_dt to write a row for
+long int next_metrics_n_events = LONG_MAX;  ///< Next multiple of \ref metrics_n_events to write a row for
+
+std::unique_ptr<output_sink> metrics_sink;
+vector<link_type> metrics_lts;           ///< Link types with a column, in column order
+timepoint last_metrics_t = -INFINITY;    ///< Time of last row written
+long int last_metrics_n_events = -1;     ///< No. of events at last row written
+
+/** \returns x formatted with enough digits for analysis, but compactly
+ */
+inline string metrics_number (double x)
+{
+    char s[32];
+    snprintf(s, sizeof(s), "%.10g", x);
+    return s;
+}
+
+/** Open the metrics file, write its header, and set the first sampling points.
+ */
+void init_metrics ()
+{
+    if (metrics_filename == "") return;
+    if (verbose) cout << " prepare metrics output file " << metrics_filename << endl;
+    bool is_gz = (metrics_filename.size() > 3) && (metrics_filename.substr(metrics_filename.size() - 3) == ".gz");
+    metrics_sink.reset(new output_sink(metrics_filename, is_gz ? CM_GZIP : CM_NONE));
+
+    // columns for all link types that may occur (those of possible events, their inverses, and initial ones):
+    std::set<std::tuple<entity_type, relationship_or_action_type, entity_type>> lts;
+    for (auto& evt : possible_evts) {
+        lts.insert({ evt.et1, evt.rat13, evt.et3 });
+        auto rat31 = rat2inv.at(evt.rat13);
+        if (rat31 != NO_RAT) lts.insert({ evt.et3, rat31, evt.et1 });
+    }
+    for (auto& [lt, n] : lt2n) lts.insert({ lt.et1, lt.rat13, lt.et3 });
+    for (auto& [et1, rat13, et3] : lts) {
+        auto rat31 = rat2inv.at(rat13);
+        if ((rat31 == NO_RAT) || (rat31 >= rat13)) metrics_lts.push_back({ et1, rat13, et3 });
+    }
+
+    auto& out = *metrics_sink;
+    out << "t,events,links,angles,effective rate,logl";
+    for (auto& lt : metrics_lts) {
+        std::ostringstream s;
+        s << lt;
+        out << ',' << csv_quoted(s.str());
+    }
+    out << '\n';
+
+    // a new run starts with a row for its initial state:
+    next_metrics_t = (metrics_dt < INFINITY)
+            ? ((resume_filename == "") ? current_t : (floor(current_t / metrics_dt) + 1) * metrics_dt)
+            : INFINITY;
+    next_metrics_n_events = (metrics_n_events < LONG_MAX) ? (n_events / metrics_n_events + 1) * metrics_n_events : LONG_MAX;
+}
+
+/** Write a row with the current state, labelled with time t.
+ */
+void write_metrics_row (timepoint t)
+{
+    if (!metrics_sink || ((t == last_metrics_t) && (n_events == last_metrics_n_events))) return;
+    auto& out = *metrics_sink;
+    out << metrics_number(t) << ',' << n_events << ',' << n_links << ',' << n_angles << ','
+        << metrics_number(total_finite_effective_rate) << ',' << metrics_number(cumulative_logl);
+    for (auto& lt : metrics_lts) {
+        auto it = lt2n.find(lt);
+        out << ',' << ((it == lt2n.end()) ? 0L : it->second);
+    }
+    out << '\n';
+    last_metrics_t = t;
+    last_metrics_n_events = n_events;
+}
+
+/** Write rows for all multiples of \ref metrics_dt before t.
+ */
+void write_metrics_rows_until (timepoint t)
+{
+    while (next_metrics_t < t) {
+        write_metrics_row(next_metrics_t);
+        next_metrics_t = (round(next_metrics_t / metrics_dt) + 1) * metrics_dt;  // (avoids accumulating rounding errors)
+    }
+}
+
+/** Write the remaining rows up to the current time and a row for the final state, and close the file.
+ */
+void finish_metrics ()
+{
+    if (!metrics_sink) return;
+    if (!quiet) cout << " complete metrics output file " << metrics_filename << endl;
+    while (next_metrics_t <= current_t) {
+        write_metrics_row(next_metrics_t);
+        next_metrics_t = (round(next_metrics_t / metrics_dt) + 1) * metrics_dt;  // (avoids accumulating rounding errors)
+    }
+    write_metrics_row(current_t);
+    metrics_sink->close();
+    metrics_sink.reset();
+}
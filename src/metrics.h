@@ -0,0 +1,36 @@
+// make sure this file is only included once:
+#ifndef INC_METRICS_H
+#define INC_METRICS_H
+
+#include "global_variables.h"
+
+extern timepoint next_metrics_t;
+extern long int next_metrics_n_events;
+
+void init_metrics ();
+
+void write_metrics_row (timepoint t);
+
+void write_metrics_rows_until (timepoint t);
+
+void finish_metrics ();
+
+/** Write rows for all sampling times before t, at which the state is still the current one
+ *  (to be called before model time advances to t).
+ */
+inline void sample_metrics_before (timepoint t)
+{
+    if (next_metrics_t < t) write_metrics_rows_until(t);
+}
+
+/** Write a row if the no. of events is a multiple of \ref metrics_n_events (to be called after each event).
+ */
+inline void sample_metrics_if_due ()
+{
+    if (n_events >= next_metrics_n_events) {
+        write_metrics_row(current_t);
+        next_metrics_n_events += metrics_n_events;
+    }
+}
+
+#endif
@@ -0,0 +1,44 @@
+// make sure this file is only included once:
+#ifndef INC_PARALLEL_H
+#define INC_PARALLEL_H
+
+/** Simple fork-join parallelism for initialization tasks.
+ *
+ *  \file
+ *
+ *  Functions run this way must only read shared data (using find() or at(),
+ *  never operator[] of maps) and write to disjoint locations.
+ *  Since debug output is not thread-safe, \ref n_threads is 1 in debug mode.
+ */
+
+#include <thread>
+
+#include "global_variables.h"
+#include "profile.h"
+
+/** Split the indices 0...n-1 into at most \ref n_threads contiguous chunks of about equal size
+ *  and call f(chunk, begin, end) for each chunk in a separate thread, then wait for all of them.
+ *
+ *  Chunks are numbered 0,1,... in increasing order of their indices,
+ *  so that per-chunk results can be merged deterministically.
+ */
+template <typename F>
+inline void parallel_for (
+        size_t n,  ///< [in] no. of indices
+        F f        ///< [in] function (unsigned chunk, size_t begin, size_t end) to call for each chunk [begin, end)
+        )
+{
+    unsigned n_chunks = max((size_t)1, min((size_t)n_threads, n));
+    vector<std::thread> workers;
+    for (unsigned chunk = 1; chunk < n_chunks; chunk++) {
+        workers.emplace_back([&f](unsigned c, size_t begin, size_t end) {
+            f(c, begin, end);
+            PROFILE_THREAD_DONE();  // (their profiling counters are per thread)
+        }, chunk, n * chunk / n_chunks, n * (chunk + 1) / n_chunks);
+    }
+    // the calling thread does the first chunk itself:
+    f(0, 0, n / n_chunks);
+    for (auto& w : workers) w.join();
+}
+
+#endif
@@ -0,0 +1,150 @@
+// make sure this file is only included once:
+#ifndef INC_PHILOX_H
+#define INC_PHILOX_H
+
+/** A counter-based pseudo-random number generator.
+ *
+ *  \file
+ *
+ *  Implements the Philox4x32-10 generator of Salmon et al. (2011),
+ *  "Parallel random numbers: as easy as 1, 2, 3".
+ *
+ *  In contrast to a sequential generator like mt19937, each block of four outputs
+ *  is a pure function of a key and a counter. We use the key for the seed
+ *  and the stream id, and the upper half of the counter for the replicate no.,
+ *  so that every (seed, replicate, stream) triple gets its own independent
+ *  sequence that does not depend on how many other sequences are being drawn
+ *  in parallel or in which order.
+ */
+
+#include <assert.h>
+#include <stdint.h>
+
+#define PHILOX_MAX_BATCH 256  ///< Max. no. of blocks generated at once by philox4x32::generate_blocks()
+
+namespace tricl {
+
+/** The Philox4x32-10 generator.
+ *
+ *  Satisfies the UniformRandomBitGenerator requirements,
+ *  so it can be used with the std distributions.
+ *
+ *  All members are public and trivially copyable so that the complete state can be
+ *  stored in and restored from a snapshot.
+ */
+struct philox4x32
+{
+    typedef uint32_t result_type;
+
+    uint32_t key[2] = { 0, 0 };          ///< (seed, stream id)
+    uint32_t counter[4] = { 0, 0, 0, 0 };  ///< (block no. low, block no. high, replicate low, replicate high)
+    uint32_t block[4] = { 0, 0, 0, 0 };    ///< last generated block of output
+    int pos = 4;                           ///< position of next output in block (4 = block used up)
+
+    philox4x32 () {}
+
+    philox4x32 (
+            uint32_t seed,          ///< [in] random seed
+            uint64_t replicate = 0, ///< [in] no. of replicate run
+            uint32_t stream = 0     ///< [in] id of stream within this replicate
+            )
+    {
+        key[0] = seed;
+        key[1] = stream;
+        counter[2] = (uint32_t) replicate;
+        counter[3] = (uint32_t) (replicate >> 32);
+    }
+
+    static constexpr result_type min () { return 0; }
+    static constexpr result_type max () { return UINT32_MAX; }
+
+    inline result_type operator() ()
+    {
+        if (pos == 4) _next_block();
+        return block[pos++];
+    }
+
+    /** Write the next n blocks of output to out[0...4n-1] and advance the counter by n,
+     *  bypassing the single-output buffer.
+     *
+     *  The rounds are computed for all n counters at once (structure of arrays),
+     *  so that the compiler can vectorise the inner loops.
+     *  The result is identical to n sequential calls of _next_block().
+     */
+    inline void generate_blocks (
+            uint32_t* out,  ///< [out] array of length 4n
+            int n           ///< [in] no. of blocks, <= PHILOX_MAX_BATCH
+            )
+    {
+        assert (n <= PHILOX_MAX_BATCH);
+        uint32_t c0[PHILOX_MAX_BATCH], c1[PHILOX_MAX_BATCH], c2[PHILOX_MAX_BATCH], c3[PHILOX_MAX_BATCH];
+        uint64_t block_no = counter[0] | ((uint64_t) counter[1] << 32);
+        for (int j = 0; j < n; j++)
+        {
+            c0[j] = (uint32_t) (block_no + j);
+            c1[j] = (uint32_t) ((block_no + j) >> 32);
+            c2[j] = counter[2];
+            c3[j] = counter[3];
+        }
+        uint32_t k0 = key[0], k1 = key[1];
+        for (int round = 0; round < 10; round++)
+        {
+            if (round > 0)
+            {
+                k0 += 0x9E3779B9;
+                k1 += 0xBB67AE85;
+            }
+            for (int j = 0; j < n; j++)
+            {
+                uint64_t p0 = (uint64_t) 0xD2511F53 * c0[j],
+                         p1 = (uint64_t) 0xCD9E8D57 * c2[j];
+                uint32_t new0 = (uint32_t) (p1 >> 32) ^ c1[j] ^ k0,
+                         new2 = (uint32_t) (p0 >> 32) ^ c3[j] ^ k1;
+                c1[j] = (uint32_t) p1;
+                c3[j] = (uint32_t) p0;
+                c0[j] = new0;
+                c2[j] = new2;
+            }
+        }
+        for (int j = 0; j < n; j++)
+        {
+            out[4*j] = c0[j]; out[4*j+1] = c1[j]; out[4*j+2] = c2[j]; out[4*j+3] = c3[j];
+        }
+        block_no += n;
+        counter[0] = (uint32_t) block_no;
+        counter[1] = (uint32_t) (block_no >> 32);
+    }
+
+    /** Compute the next block of four outputs and advance the counter.
+     */
+    inline void _next_block ()
+    {
+        uint32_t c[4] = { counter[0], counter[1], counter[2], counter[3] };
+        uint32_t k0 = key[0], k1 = key[1];
+        for (int round = 0; round < 10; round++)
+        {
+            if (round > 0)
+            {
+                // bump key (Weyl sequence):
+                k0 += 0x9E3779B9;
+                k1 += 0xBB67AE85;
+            }
+            uint64_t p0 = (uint64_t) 0xD2511F53 * c[0],
+                     p1 = (uint64_t) 0xCD9E8D57 * c[2];
+            uint32_t hi0 = (uint32_t) (p0 >> 32), lo0 = (uint32_t) p0,
+                     hi1 = (uint32_t) (p1 >> 32), lo1 = (uint32_t) p1;
+            c[0] = hi1 ^ c[1] ^ k0;
+            c[1] = lo1;
+            c[2] = hi0 ^ c[3] ^ k1;
+            c[3] = lo0;
+        }
+        block[0] = c[0]; block[1] = c[1]; block[2] = c[2]; block[3] = c[3];
+        pos = 0;
+        // increment 64-bit block no.:
+        if (++counter[0] == 0) ++counter[1];
+    }
+};
+
+} // end of namespace tricl
+
+#endif
@@ -8,21 +8,56 @@
 
 // random generators:
 random_device ran_dev;
-mt19937 random_variable;
+philox4x32 random_variable;
 uniform_real_distribution<> uniform(0, 1);
-exponential_distribution<> exponential(1);
+double exponentials[EXPONENTIAL_BATCH];
+int next_exponential_pos = EXPONENTIAL_BATCH;  // i.e., buffer is empty
 
-/** Initialize the pseudo-random number generator using specified seed.
+/** Initialize the pseudo-random number generator using specified seed
+ *  for a particular replicate and stream.
  *
- *  Uses a pseudo-random seed if seed == 0.
+ *  Uses a pseudo-random seed if seed == 0 (and stores it in seed
+ *  so that all later streams use the same one).
+ *
+ *  Since the generator is counter-based, the resulting sequence only depends
+ *  on (seed, replicate, stream), not on the no. of threads or their scheduling.
  */
-void init_randomness ()
+void init_randomness (
+        uint64_t replicate,  ///< [in] no. of the replicate run
+        uint32_t stream      ///< [in] id of the stream within this replicate
+        )
 {
-    auto theseed = (seed == 0) ? ran_dev() : seed;
-    if (!quiet) cout << " using random seed " << theseed << endl;
-    random_variable = mt19937(theseed);
+    if (seed == 0) seed = ran_dev();
+    if (!quiet) cout << " using random seed " << seed << ", replicate " << replicate << ", stream " << stream << endl;
+    random_variable = philox4x32(seed, replicate, stream);
+    // discard exponentials drawn from a previous stream:
+    next_exponential_pos = EXPONENTIAL_BATCH;
 }
 
+/** Initialize the pseudo-random number generator for the main stream
+ *  of the replicate specified in the options.
+ */
+void init_randomness ()
+{
+    init_randomness(replicate, 0);
+}
 
-
-
+/** Refill the buffer of exponentially distributed random numbers.
+ *
+ *  The underlying random bits are taken from \ref random_variable in one batch,
+ *  always in the same order, so that results remain reproducible for a given seed.
+ *  Both loops are free of branches and loop-carried dependencies
+ *  so that the compiler can vectorise them.
+ */
+void refill_exponentials ()
+{
+    uint32_t bits[2 * EXPONENTIAL_BATCH];
+    random_variable.generate_blocks(bits, EXPONENTIAL_BATCH / 2);
+    for (int i = 0; i < EXPONENTIAL_BATCH; i++)
+    {
+        // combine two 32-bit numbers into a 53-bit uniform number in (0,1]:
+        uint64_t x = ((uint64_t) bits[2*i] << 21) ^ (bits[2*i + 1] >> 11);
+        exponentials[i] = -log((double) (x + 1) * 0x1.0p-53);
+    }
+    next_exponential_pos = 0;
+}
@@ -10,21 +10,39 @@
 #include <random>
 
 #include "global_variables.h"
+#include "philox.h"
 
-using std::mt19937;
 using std::random_device;
 using std::uniform_real_distribution;
-using std::exponential_distribution;
+
+#define EXPONENTIAL_BATCH 512  ///< No. of exponential variates generated at once by refill_exponentials()
 
 // random generators:
-extern mt19937 random_variable;                 ///< Our pseudo-random number generator
+extern philox4x32 random_variable;              ///< Our pseudo-random number generator
 extern uniform_real_distribution<> uniform;     ///< uniform(random_variable) produces uniformly distributed numbers 0...1
-extern exponential_distribution<> exponential;  ///< exponential(random_variable) produces exponentially distributed numbers with mean 1
+extern double exponentials[EXPONENTIAL_BATCH];  ///< Buffer of pregenerated exponentially distributed numbers with mean 1
+extern int next_exponential_pos;                ///< Position of next unused number in \ref exponentials
 
 const double scale0 =  1 / 2 / exp(1);  ///< Precomputed scale parameter for tail index 0
 
+void init_randomness (uint64_t replicate, uint32_t stream);
 void init_randomness ();
 
+void refill_exponentials ();
+
+/** Draw an exponentially distributed random number with mean 1.
+ *
+ *  Rescheduling after a single event may need hundreds of these,
+ *  so they are generated in batches by \ref refill_exponentials().
+ *
+ *  \returns the number, > 0
+ */
+inline double next_exponential ()
+{
+    if (next_exponential_pos == EXPONENTIAL_BATCH) refill_exponentials();
+    return exponentials[next_exponential_pos++];
+}
+
 /** Compute the scale parameter for a tail index.
  *
  *  Auxiliary function for \ref probunits2probability().
@@ -135,6 +153,38 @@ inline void subtract_effective_rate (rate er)
     subtract_effective_rate(er, true);
 }
 
+/** Select each of the indices 0...n-1 independently with probability p
+ *  and call f(index) for each selected index, in increasing order.
+ *
+ *  Instead of drawing one uniform number per index, this jumps from one
+ *  selected index to the next by drawing geometrically distributed gaps
+ *  (as in Batagelj & Brandes 2005, "Efficient generation of large random networks"),
+ *  so the effort is proportional to the no. of selected indices rather than n.
+ */
+template <typename F>
+inline void for_random_subset (
+        size_t n,       ///< [in] no. of indices to select from
+        probability p,  ///< [in] selection probability of each index, 0...1
+        F f             ///< [in] function to call with each selected index
+        )
+{
+    if (!(p > 0.0)) return;
+    if (p >= 1.0)
+    {
+        for (size_t k = 0; k < n; k++) f(k);
+        return;
+    }
+    double log_q = log1p(-p);
+    double k = -1;  // (a double to avoid overflow when gaps get huge)
+    while (true)
+    {
+        // gap until next selected index is geometrically distributed:
+        k += 1 + floor(log1p(-uniform(random_variable)) / log_q);
+        if (!(k < n)) break;
+        f((size_t) k);
+    }
+}
+
 /** \returns actual total effective rate, taking care of infinite values.
  */
 inline rate total_effective_rate ()
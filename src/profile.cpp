@@ -0,0 +1,139 @@
+/** Optional profiling counters and timers (see \ref profile.h).
+ *
+ *  \file
+ */
+
+#include "profile.h"
+
+#ifdef TRICL_PROFILE
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+
+#include "io.h"
+
+thread_local profile_counter profile_counters[N_PROFILE_IDS] = {};
+static profile_counter finished_threads_counters[N_PROFILE_IDS] = {};  ///< Sum of the counters of finished worker threads
+static std::mutex finished_threads_mutex;                              ///< Protects \ref finished_threads_counters
+event_type_profile evt_profiles[MAX_N_EVT] = {};
+
+/** Names of the counters, as used in the table and the JSON output */
+static const char* profile_labels[N_PROFILE_IDS] = {
+    "add_event",
+    "get_angles",
+    "add_or_delete_angle",
+    "_schedule_event",
+    "pop_next_event",
+    "summary draws",
+    "summary rejections: link existed",
+    "summary rejections: e1 == e3",
+    "summary rejections: scheduled separately",
+    "summary rejections: failed success test",
+    "gexf_output_edge",
+};
+
+// reference points for converting ticks to seconds (taken at program start):
+static const auto profile_start_time = std::chrono::steady_clock::now();
+static const auto profile_start_ticks = profile_ticks();
+
+/** \returns x / n, or 0 if n is 0
+ */
+static double profile_mean (unsigned long int x, unsigned long int n)
+{
+    return n ? (double)x / n : 0.0;
+}
+
+/** Add this thread's counters to those of the finished worker threads and reset them.
+ */
+void merge_thread_profile ()
+{
+    std::lock_guard<std::mutex> lock(finished_threads_mutex);
+    for (int id = 0; id < N_PROFILE_IDS; id++) {
+        finished_threads_counters[id].calls += profile_counters[id].calls;
+        finished_threads_counters[id].ticks += profile_counters[id].ticks;
+        profile_counters[id] = {};
+    }
+}
+
+/** Print a table of all counters and timers and a table of the counters by event type,
+ *  and write them to files:profile as JSON (if specified).
+ */
+void report_profile ()
+{
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - profile_start_time).count();
+    double ticks_per_second = (profile_ticks() - profile_start_ticks) / max(seconds, 1e-9);
+    // (including the worker threads' counts:)
+    merge_thread_profile();
+    auto& counters = finished_threads_counters;
+
+    // event types with nonzero counters, in a fixed order:
+    vector<pair<string, event_type_profile*>> evt_rows;
+    for (auto& evt : possible_evts) {
+        auto& p = evt_profile(evt);
+        if (p.schedules + p.reschedules + p.compiled + p.performed + p.summary_draws == 0) continue;
+        std::ostringstream s;
+        s << evt;
+        evt_rows.push_back({ s.str(), &p });
+    }
+    sort(evt_rows.begin(), evt_rows.end());
+    if (!silent) {
+        cout << "PROFILE (inclusive times, incl. initialization, " << seconds << " s wall time):" << endl;
+        char buf[256];
+        snprintf(buf, sizeof(buf), " %-42s %14s %12s %10s %7s", "", "calls", "seconds", "ns/call", "%");
+        cout << buf << endl;
+        for (int id = 0; id < N_PROFILE_IDS; id++) {
+            auto& c = counters[id];
+            if (c.ticks > 0) {
+                double s = c.ticks / ticks_per_second;
+                snprintf(buf, sizeof(buf), " %-42s %14lu %12.3f %10.1f %7.2f",
+                        profile_labels[id], c.calls, s, 1e9 * s / max(c.calls, 1UL), 100 * s / seconds);
+            } else {
+                snprintf(buf, sizeof(buf), " %-42s %14lu", profile_labels[id], c.calls);
+            }
+            cout << buf << endl;
+        }
+        cout << "PROFILE BY EVENT TYPE (angles: mean no. per compiled/performed event, draws: of summary event, accepted: % of draws):" << endl;
+        snprintf(buf, sizeof(buf), " %12s %12s %8s %12s %8s %12s %12s %12s %12s %12s %8s  %s",
+                "scheduled", "rescheduled", "angles", "performed", "angles", "draws", "existed", "e1 == e3", "separate", "failed", "accepted", "event type");
+        cout << buf << endl;
+        for (auto& [label, p] : evt_rows) {
+            char accepted[16] = "-";
+            if (p->summary_draws > 0) snprintf(accepted, sizeof(accepted), "%.2f",
+                    100 * profile_mean(p->summary_draws - p->reject_exists - p->reject_equal - p->reject_separate - p->reject_failed, p->summary_draws));
+            snprintf(buf, sizeof(buf), " %12lu %12lu %8.2f %12lu %8.2f %12lu %12lu %12lu %12lu %12lu %8s  ",
+                    p->schedules, p->reschedules, profile_mean(p->compiled_angles, p->compiled),
+                    p->performed, profile_mean(p->touched_angles, p->performed),
+                    p->summary_draws, p->reject_exists, p->reject_equal, p->reject_separate, p->reject_failed, accepted);
+            cout << buf << label << endl;
+        }
+    }
+    if (profile_filename != "") {
+        std::ofstream f(profile_filename);
+        if (!f) throw "cannot write profile file";
+        f << "{\n  \"wall seconds\": " << seconds << ",\n  \"ticks per second\": " << ticks_per_second << ",\n  \"counters\": {";
+        for (int id = 0; id < N_PROFILE_IDS; id++) {
+            auto& c = counters[id];
+            f << (id ? "," : "") << "\n    \"" << profile_labels[id] << "\": {\"calls\": " << c.calls;
+            if (c.ticks > 0) f << ", \"seconds\": " << c.ticks / ticks_per_second;
+            f << "}";
+        }
+        f << "\n  },\n  \"event types\": {";
+        bool first = true;
+        for (auto& [label, p] : evt_rows) {
+            f << (first ? "" : ",") << "\n    \"" << label << "\": {\"schedules\": " << p->schedules
+              << ", \"reschedules\": " << p->reschedules << ", \"compiled\": " << p->compiled
+              << ", \"compiled angles\": " << p->compiled_angles << ", \"performed\": " << p->performed
+              << ", \"touched angles\": " << p->touched_angles << ", \"summary draws\": " << p->summary_draws
+              << ", \"summary rejections\": {\"link existed\": " << p->reject_exists << ", \"e1 == e3\": " << p->reject_equal
+              << ", \"scheduled separately\": " << p->reject_separate << ", \"failed success test\": " << p->reject_failed << "}}";
+            first = false;
+        }
+        f << "\n  }\n}\n";
+        if (!quiet) cout << " wrote profile to " << profile_filename << endl;
+    }
+}
+
+#endif
@@ -0,0 +1,129 @@
+// make sure this file is only included once:
+#ifndef INC_PROFILE_H
+#define INC_PROFILE_H
+
+/** Optional low-overhead profiling counters and timers for the hot paths.
+ *
+ *  \file
+ *
+ *  Only compiled in if TRICL_PROFILE is defined (cmake option -DTRICL_PROFILE=ON),
+ *  otherwise all PROFILE_... macros expand to nothing.
+ *  Timers read the CPU's time stamp counter (on x86-64, otherwise a steady clock)
+ *  and measure inclusive time, e.g. the time of \ref add_event includes that of \ref get_angles.
+ *  The counts cover the whole run including initialization.
+ *  In addition, \ref event_type_profile counters record per event type how often events are
+ *  scheduled, rescheduled, compiled and performed, how many angles this touches,
+ *  and how summary events' draws of entity pairs end.
+ *  They are reported by \ref finish() as tables and written to files:profile as JSON.
+ *
+ *  Since initialization calls \ref get_angles etc. from several threads (see \ref parallel_for),
+ *  \ref profile_counters are per thread, and worker threads add theirs to a common total when they finish
+ *  (see \ref merge_thread_profile). The event type counters are only updated by the simulation thread.
+ */
+
+#include "global_variables.h"
+
+#ifdef TRICL_PROFILE
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+/** Counted (and possibly timed) code locations.
+ */
+enum profile_id {
+    PROF_ADD_EVENT,
+    PROF_GET_ANGLES,
+    PROF_ADD_OR_DELETE_ANGLE,
+    PROF_SCHEDULE_EVENT,
+    PROF_POP_NEXT_EVENT,
+    PROF_SUMMARY_DRAW,             ///< entity pair drawn for a summary event
+    PROF_SUMMARY_REJECT_EXISTS,    ///< rejected since the link existed already
+    PROF_SUMMARY_REJECT_EQUAL,     ///< rejected since e1 == e3
+    PROF_SUMMARY_REJECT_SEPARATE,  ///< rejected since the event is scheduled separately
+    PROF_SUMMARY_REJECT_FAILED,    ///< rejected by the success test
+    PROF_GEXF_OUTPUT_EDGE,
+    N_PROFILE_IDS
+};
+
+struct profile_counter
+{
+    unsigned long int calls;  ///< no. of calls
+    unsigned long int ticks;  ///< total inclusive duration in ticks (0 if not timed)
+};
+
+extern thread_local profile_counter profile_counters[N_PROFILE_IDS];  ///< This thread's counters
+
+void merge_thread_profile ();
+
+/** \returns the current value of the time stamp counter
+ */
+inline unsigned long int profile_ticks ()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+/** Adds the duration of its lifetime to a \ref profile_counter.
+ */
+class profile_timer
+{
+    profile_counter& counter;
+    unsigned long int start;
+public:
+    profile_timer (profile_id id) : counter(profile_counters[id]), start(profile_ticks()) {}
+    ~profile_timer () { counter.calls++; counter.ticks += profile_ticks() - start; }
+};
+
+/** Counters for one \ref event_type.
+ */
+struct event_type_profile
+{
+    unsigned long int schedules;        ///< no. of times an event was scheduled when added
+    unsigned long int reschedules;      ///< no. of times an event was rescheduled (summary events: after every draw)
+    unsigned long int compiled;         ///< no. of events whose data was compiled (initial and added events)
+    unsigned long int compiled_angles;  ///< total no. of influencing angles found when compiling them
+    unsigned long int performed;        ///< no. of performed events
+    unsigned long int touched_angles;   ///< total no. of angles added or deleted when performing them (incl. companion events)
+    unsigned long int summary_draws;    ///< no. of entity pairs drawn for the summary event
+    unsigned long int reject_exists;    ///< ... rejected since the link existed already
+    unsigned long int reject_equal;     ///< ... rejected since e1 == e3
+    unsigned long int reject_separate;  ///< ... rejected since the event is scheduled separately
+    unsigned long int reject_failed;    ///< ... rejected by the success test
+};
+
+#define MAX_N_EVT (1 << (2+2*ET_BITS+RAT_BITS))  ///< No. of possible event type indices, see \ref evt_profile()
+
+extern event_type_profile evt_profiles[MAX_N_EVT];
+
+/** \returns the counters of an event type (indexed like its hash value)
+ */
+inline event_type_profile& evt_profile (const event_type& evt)
+{
+    return evt_profiles[(size_t)evt.ec ^ ((size_t)evt.et1 << 2) ^ ((size_t)evt.rat13 << (2+ET_BITS)) ^ ((size_t)evt.et3 << (2+ET_BITS+RAT_BITS))];
+}
+
+#define PROFILE_SCOPE(id) profile_timer _profile_timer_(id)  ///< Time the rest of the enclosing scope
+#define PROFILE_COUNT(id) (profile_counters[id].calls++)     ///< Count without timing
+#define PROFILE_EVT(evt, field, n) (evt_profile(evt).field += (n))  ///< Add n to a counter of an event type
+#define PROFILE_THREAD_DONE() merge_thread_profile()  ///< To be called at the end of a worker thread
+
+void report_profile ();
+
+#else
+
+#define PROFILE_SCOPE(id)
+#define PROFILE_COUNT(id)
+#define PROFILE_EVT(evt, field, n)
+#define PROFILE_THREAD_DONE()
+
+inline void report_profile () {}
+
+#endif
+
+#endif
@@ -3,8 +3,14 @@
  *  \file
  */
 
+#include <limits.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <chrono>
+
 #include "global_variables.h"
 #include "event.h"
+#include "metrics.h"
 #include "simulate.h"
 
 /** Perform next step.
@@ -16,9 +22,59 @@ bool step ()
     if ((n_events < max_n_events) && pop_next_event()) {
         ++n_events;
         perform_event(current_ev, current_evd_);
+        sample_metrics_if_due();
         if (debug) cout << " " << t2ev.size() << " events on stack" << endl << endl;
         return true;
     } else {
         return false;
     }
 }
+
+const auto wall_start_time = std::chrono::steady_clock::now();  ///< (initialized at program start)
+long int next_limits_check = 0;  ///< No. of events at which \ref limits_reached_if_due calls \ref check_limits next
+string stopped_by_limit = "";    ///< Limit that stopped the run before limits:t and limits:events ("wall" or "rss", if "", none)
+
+/** \returns the wall time since program start in seconds
+ */
+double wall_seconds ()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start_time).count();
+}
+
+/** \returns the current resident set size of this process in MB (or 0 if unknown)
+ */
+double rss_mb ()
+{
+    long int pages = 0, resident = 0;
+    FILE* f = fopen("/proc/self/statm", "r");
+    if (f == NULL) return 0;
+    if (fscanf(f, "%ld %ld", &pages, &resident) != 2) resident = 0;
+    fclose(f);
+    return (double) resident * sysconf(_SC_PAGESIZE) / (1<<20);
+}
+
+/** \returns the peak resident set size of this process so far in MB
+ */
+double peak_rss_mb ()
+{
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) != 0) return 0;
+    return ru.ru_maxrss / 1024.0;  // (ru_maxrss is in KB)
+}
+
+/** Check whether limits:wall or limits:rss has been reached, and set the next check.
+ *
+ *  Only called every \ref LIMITS_CHECK_EVENTS events, so that the simulation loop does not read the clock
+ *  or /proc each time.
+ *
+ *  \returns whether the run should stop
+ */
+bool check_limits ()
+{
+    next_limits_check = ((max_wall_seconds < INFINITY) || (max_rss_mb < INFINITY)) ? n_events + LIMITS_CHECK_EVENTS : LONG_MAX;
+    if (wall_seconds() >= max_wall_seconds) stopped_by_limit = "wall";
+    else if ((max_rss_mb < INFINITY) && (rss_mb() >= max_rss_mb)) stopped_by_limit = "rss";
+    else return false;
+    if (!silent) cout << endl << "limits:" << stopped_by_limit << " reached at t=" << current_t << " after " << n_events << " events, stopping." << endl;
+    return true;
+}
@@ -1 +1,29 @@
+// make sure this file is only included once:
+#ifndef INC_SIMULATE_H
+#define INC_SIMULATE_H
+
+#include "global_variables.h"
+
+#define LIMITS_CHECK_EVENTS 4096  ///< No. of events between checks of the wall time and memory limits
+
+extern long int next_limits_check;
+extern string stopped_by_limit;
+
 bool step ();
+
+double wall_seconds ();
+
+double rss_mb ();
+
+double peak_rss_mb ();
+
+bool check_limits ();
+
+/** \returns whether limits:wall or limits:rss has been reached (cheap enough to be called after each event).
+ */
+inline bool limits_reached_if_due ()
+{
+    return (n_events >= next_limits_check) && check_limits();
+}
+
+#endif
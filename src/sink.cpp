@@ -0,0 +1,174 @@
+/** Buffered output files, optionally gzip-compressed.
+ *
+ *  \file
+ */
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "global_variables.h"
+#include "sink.h"
+
+/** A pool of worker threads compressing blocks into independent gzip members.
+ */
+class compression_pool
+{
+    vector<std::thread> workers;
+    std::mutex m;
+    std::condition_variable cv;
+    std::deque<std::function<void()>> jobs;
+    bool stopping = false;
+
+    void run ()
+    {
+        while (true) {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(m);
+                cv.wait(lock, [this]() { return stopping || !jobs.empty(); });
+                if (jobs.empty()) return;
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+            job();
+        }
+    }
+
+public:
+    compression_pool (unsigned n)
+    {
+        for (unsigned i = 0; i < n; i++) workers.emplace_back([this]() { run(); });
+    }
+    ~compression_pool ()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m);
+            stopping = true;
+        }
+        cv.notify_all();
+        for (auto& w : workers) w.join();
+    }
+
+    unsigned size () { return workers.size(); }
+
+    /** Queue a block for compression.
+     *
+     *  \returns the future gzip member
+     */
+    std::future<string> submit (string data)
+    {
+        auto task = std::make_shared<std::packaged_task<string()>>([d = std::move(data)]() {
+            z_stream zs;
+            zs.zalloc = Z_NULL; zs.zfree = Z_NULL; zs.opaque = Z_NULL;
+            if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) throw
+                    "cannot initialize compression";
+            string z(deflateBound(&zs, d.size()), '\0');
+            zs.next_in = (Bytef*) d.data();
+            zs.avail_in = d.size();
+            zs.next_out = (Bytef*) z.data();
+            zs.avail_out = z.size();
+            deflate(&zs, Z_FINISH);  // (the bound guarantees completion in one call)
+            z.resize(z.size() - zs.avail_out);
+            deflateEnd(&zs);
+            return z;
+        });
+        auto f = task->get_future();
+        {
+            std::lock_guard<std::mutex> lock(m);
+            jobs.emplace_back([task]() { (*task)(); });
+        }
+        cv.notify_one();
+        return f;
+    }
+};
+
+std::unique_ptr<compression_pool> sink_pool;  ///< Shared by all sinks using CM_PARALLEL_GZIP, started when the first one is opened
+
+output_sink::output_sink (
+        const string& filename,
+        compression_method cm
+        )
+{
+    file = fopen(filename.c_str(), "wb");
+    if (file == NULL) throw "cannot open output file";
+    method = cm;
+    if (method == CM_GZIP) {
+        zs.zalloc = Z_NULL; zs.zfree = Z_NULL; zs.opaque = Z_NULL;
+        // windowBits 15 + 16 selects the gzip format:
+        if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) throw
+                "cannot initialize compression";
+        zbuf.resize(SINK_BUFFER_BYTES);
+    } else if (method == CM_PARALLEL_GZIP) {
+        if (!sink_pool) sink_pool.reset(new compression_pool(max(1u, n_threads)));
+        buffer_bytes = SINK_PARALLEL_BLOCK_BYTES;
+    }
+    buf.reserve(buffer_bytes + (1<<16));
+}
+
+output_sink::~output_sink ()
+{
+    // (only reached without close() if an exception is already propagating, so a write error is not reported again)
+    try {
+        close();
+    } catch (...) {}
+}
+
+/** Write the buffer to the file, compressing it first if necessary.
+ */
+void output_sink::write_buffer (
+        bool finish  ///< [in] whether this is the last data (which completes the gzip stream)
+        )
+{
+    if (method == CM_GZIP) {
+        zs.next_in = (Bytef*) buf.data();
+        zs.avail_in = buf.size();
+        do {
+            zs.next_out = (Bytef*) zbuf.data();
+            zs.avail_out = zbuf.size();
+            deflate(&zs, finish ? Z_FINISH : Z_NO_FLUSH);
+            size_t n = zbuf.size() - zs.avail_out;
+            if (fwrite(zbuf.data(), 1, n, file) != n) write_failed = true;
+        } while (zs.avail_out == 0);
+    } else if (method == CM_PARALLEL_GZIP) {
+        if (!buf.empty()) {
+            pending.push_back(sink_pool->submit(std::move(buf)));
+            buf = string();
+            buf.reserve(buffer_bytes + (1<<16));
+        }
+        write_pending(finish ? 0 : SINK_PENDING_BLOCKS_PER_WORKER * sink_pool->size());
+        return;
+    } else {
+        if (fwrite(buf.data(), 1, buf.size(), file) != buf.size()) write_failed = true;
+    }
+    buf.clear();
+}
+
+/** Write all compressed gzip members that are ready, in order,
+ *  and wait for more while too many are still pending (so that memory use stays bounded).
+ */
+void output_sink::write_pending (
+        size_t max_pending  ///< [in] max. no. of members that may remain pending
+        )
+{
+    while (!pending.empty()
+            && ((pending.size() > max_pending)
+                || (pending.front().wait_for(std::chrono::seconds(0)) == std::future_status::ready))) {
+        auto z = pending.front().get();
+        if (fwrite(z.data(), 1, z.size(), file) != z.size()) write_failed = true;
+        pending.pop_front();
+    }
+}
+
+void output_sink::close ()
+{
+    if (file == NULL) return;
+    write_buffer(true);
+    if (method == CM_GZIP) deflateEnd(&zs);
+    if (ferror(file)) write_failed = true;
+    if (fclose(file) != 0) write_failed = true;
+    file = NULL;
+    if (write_failed) throw "cannot write output file (disk full?)";
+}
@@ -0,0 +1,103 @@
+// make sure this file is only included once:
+#ifndef INC_SINK_H
+#define INC_SINK_H
+
+/** Buffered output files, optionally gzip-compressed.
+ *
+ *  \file
+ */
+
+#include <stdio.h>
+#include <zlib.h>
+#include <charconv>
+#include <deque>
+#include <future>
+#include <string_view>
+
+#include "data_model.h"
+
+using std::string_view;
+
+#define SINK_BUFFER_BYTES (1<<22)          ///< Size of the buffer of an \ref output_sink, after which it is written (and compressed)
+#define SINK_PARALLEL_BLOCK_BYTES (1<<20)  ///< Size of the blocks compressed independently by \ref CM_PARALLEL_GZIP
+#define SINK_PENDING_BLOCKS_PER_WORKER 2   ///< Max. no. of blocks per worker thread that may be waiting for compression
+
+/** How an \ref output_sink compresses its output.
+ */
+enum compression_method {
+    CM_NONE,          ///< Uncompressed
+    CM_GZIP,          ///< One gzip stream, compressed by the thread writing to the sink
+    CM_PARALLEL_GZIP  ///< Independent blocks compressed by a pool of worker threads and concatenated as gzip members (like pigz)
+};
+
+/** An output file owned for the whole run, with its own large buffer.
+ *
+ *  Text is appended to the buffer by the operator<< overloads (which format numbers
+ *  like a default-configured ostream would, but without locale or virtual calls).
+ *  Whenever the buffer is full, it is written to the file, gzip-compressed if the sink was opened that way.
+ *  With \ref CM_PARALLEL_GZIP, each full buffer is instead handed to the worker pool
+ *  and the resulting gzip members are written in their original order.
+ */
+class output_sink
+{
+    FILE* file = NULL;
+    compression_method method = CM_NONE;
+    size_t buffer_bytes = SINK_BUFFER_BYTES;
+    z_stream zs;
+    string buf;   ///< uncompressed data not yet written
+    string zbuf;  ///< compressed data
+    std::deque<std::future<string>> pending;  ///< gzip members being compressed by the worker pool, in file order
+    bool write_failed = false;  ///< whether some data could not be written (reported by close())
+
+    void write_buffer (bool finish);
+    void write_pending (size_t max_pending);
+
+public:
+    output_sink (
+            const string& filename,  ///< [in] name of (or path to) file
+            compression_method cm    ///< [in] how to compress the output
+            );
+    ~output_sink ();
+    output_sink (const output_sink&) = delete;
+    output_sink& operator= (const output_sink&) = delete;
+
+    inline output_sink& operator<< (string_view s)
+    {
+        buf.append(s.data(), s.size());
+        if (buf.size() >= buffer_bytes) write_buffer(false);
+        return *this;
+    }
+    inline output_sink& operator<< (char c)
+    {
+        buf.push_back(c);
+        return *this;
+    }
+    inline output_sink& operator<< (long int x)
+    {
+        char s[24];
+        auto res = std::to_chars(s, s + sizeof(s), x);
+        return *this << string_view(s, res.ptr - s);
+    }
+    inline output_sink& operator<< (unsigned long int x)
+    {
+        char s[24];
+        auto res = std::to_chars(s, s + sizeof(s), x);
+        return *this << string_view(s, res.ptr - s);
+    }
+    inline output_sink& operator<< (int x) { return *this << (long int) x; }
+    inline output_sink& operator<< (double x)
+    {
+        char s[32];
+        int n = snprintf(s, sizeof(s), "%g", x);  // same as an ostream's default format
+        return *this << string_view(s, n);
+    }
+
+    /** Write all remaining data and close the file.
+     *
+     *  Throws if any data could not be written, also earlier (e.g. on a full disk).
+     *  Earlier failures are only reported here since the sink may be written by a background thread.
+     */
+    void close ();
+};
+
+#endif
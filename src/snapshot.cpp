@@ -0,0 +1,441 @@
+/** Writing and restoring binary snapshots of the complete simulation state.
+ *
+ *  \file
+ *
+ *  A snapshot contains everything needed to continue a run exactly as if it had not been interrupted:
+ *  the entities, the network (\ref e2outs with the links' start times, \ref e2ins),
+ *  the schedule (\ref ev2data with scheduled times),
+ *  the state of the random number generator, the log-likelihood and all counters.
+ *  Everything that is derived from the config file (types, rates, probunits, ...)
+ *  is not stored but read again from the config file, which must hence be the same
+ *  as in the interrupted run (except for limits, output options and snapshot options).
+ *
+ *  The file consists of a fixed-size header followed by a sequence of arrays,
+ *  each stored as its length (uint64) followed by its raw elements, padded to a multiple of 8 bytes.
+ *  Hence the file can be restored by mapping it into memory and copying the arrays directly
+ *  into the containers, without any parsing or re-simulation.
+ *  The format is specific to the platform and the compile-time type sizes, which are checked on restore.
+ */
+
+#include <limits.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <fstream>
+
+#include "global_variables.h"
+#include "probability.h"
+#include "io.h"
+#include "snapshot.h"
+
+using std::ofstream;
+
+/** Fixed-size start of a snapshot file.
+ */
+struct snapshot_header
+{
+    char magic[8];                ///< "TRICLSNP"
+    uint32_t version;             ///< \ref SNAPSHOT_VERSION
+    uint32_t sizeof_entity,       ///< sizeof(entity) when written
+             sizeof_outleg,       ///< sizeof(outleg) when written
+             sizeof_inleg,        ///< sizeof(inleg) when written
+             sizeof_event,        ///< sizeof(event) when written
+             sizeof_event_data;   ///< sizeof(event_data) when written
+};
+
+/** All scalar state variables.
+ */
+struct snapshot_scalars
+{
+    timepoint current_t, last_dt;
+    int64_t n_events;
+    double cumulative_logl;
+    rate total_finite_effective_rate;
+    int64_t n_infinite_effective_rates, n_links, n_angles;
+    uint64_t seed, replicate;
+    int64_t max_e;
+};
+
+struct snapshot_event
+{
+    event ev;
+    event_data evd;
+};
+
+struct snapshot_link_count
+{
+    uint64_t et1, rat13, et3;
+    int64_t n;
+};
+
+struct snapshot_entity_count
+{
+    uint64_t et;
+    int64_t n;
+};
+
+const char snapshot_magic[8] = { 'T', 'R', 'I', 'C', 'L', 'S', 'N', 'P' };
+
+static timepoint next_snapshot_t = INFINITY;   ///< Model time after which the next snapshot is due
+static long int next_snapshot_n_events = LONG_MAX;  ///< No. of events after which the next snapshot is due
+
+/** Sequential binary output to a snapshot file.
+ */
+struct snapshot_writer
+{
+    ofstream f;
+    uint64_t pos = 0;
+
+    void put_raw (const void* p, uint64_t n_bytes)
+    {
+        f.write((const char*) p, n_bytes);
+        pos += n_bytes;
+    }
+    void pad ()
+    {
+        const char zeros[8] = { 0 };
+        if (pos % 8 != 0) put_raw(zeros, 8 - pos % 8);
+    }
+    template <typename T>
+    void put (const T& x)
+    {
+        put_raw(&x, sizeof(T));
+    }
+    template <typename T>
+    void put_array (const T* p, uint64_t n)
+    {
+        put(n);
+        put_raw(p, n * sizeof(T));
+        pad();
+    }
+    template <typename T>
+    void put_vector (const vector<T>& v)
+    {
+        put_array(v.data(), v.size());
+    }
+    /** Store a list of strings as concatenated characters plus offsets.
+     */
+    void put_strings (const vector<string>& strings)
+    {
+        vector<uint64_t> offsets = { 0 };
+        string chars;
+        for (auto& s : strings) {
+            chars += s;
+            offsets.push_back(chars.size());
+        }
+        put_vector(offsets);
+        put_array(chars.data(), chars.size());
+    }
+};
+
+/** Sequential binary input from a memory-mapped snapshot file.
+ */
+struct snapshot_reader
+{
+    const char* data;
+    uint64_t size, pos = 0;
+
+    const char* get_raw (uint64_t n_bytes)
+    {
+        if (n_bytes > size - pos) throw "snapshot file is truncated or corrupt";
+        auto p = data + pos;
+        pos += n_bytes;
+        return p;
+    }
+    void skip_pad ()
+    {
+        if (pos % 8 != 0) get_raw(8 - pos % 8);
+    }
+    template <typename T>
+    T get ()
+    {
+        T x;
+        memcpy((void*) &x, get_raw(sizeof(T)), sizeof(T));
+        return x;
+    }
+    /** \returns pointer to the first element (which is 8-byte aligned since the mapping is page-aligned), and no. of elements
+     */
+    template <typename T>
+    pair<const T*, uint64_t> get_array ()
+    {
+        auto n = get<uint64_t>();
+        if (n > (size - pos) / sizeof(T)) throw "snapshot file is truncated or corrupt";
+        auto p = (const T*) get_raw(n * sizeof(T));
+        skip_pad();
+        return { p, n };
+    }
+    vector<string> get_strings ()
+    {
+        auto [offsets, n_offsets] = get_array<uint64_t>();
+        auto [chars, n_chars] = get_array<char>();
+        vector<string> strings;
+        for (uint64_t i = 1; i < n_offsets; i++) {
+            if ((offsets[i-1] > offsets[i]) || (offsets[i] > n_chars)) throw "snapshot file is truncated or corrupt";
+            strings.emplace_back(chars + offsets[i-1], offsets[i] - offsets[i-1]);
+        }
+        return strings;
+    }
+};
+
+/** Write the list of entity type or relationship type labels, by ascending id.
+ */
+template <typename T>
+void put_labels (snapshot_writer& w, const unordered_map<T, label>& x2label)
+{
+    vector<uint64_t> xs;
+    for (auto& [x, l] : x2label) xs.push_back(x);
+    sort(xs.begin(), xs.end());
+    vector<string> labels;
+    for (auto x : xs) labels.push_back(x2label.at(x));
+    w.put_vector(xs);
+    w.put_strings(labels);
+}
+
+/** Check that a list of labels stored by put_labels() equals the current one.
+ */
+template <typename T>
+void check_labels (snapshot_reader& r, const unordered_map<T, label>& x2label, const char* msg)
+{
+    auto [xs, n] = r.get_array<uint64_t>();
+    auto labels = r.get_strings();
+    if ((n != x2label.size()) || (labels.size() != n)) throw msg;
+    for (uint64_t i = 0; i < n; i++) {
+        auto it = x2label.find(xs[i]);
+        if ((it == x2label.end()) || (it->second != labels[i])) throw msg;
+    }
+}
+
+/** Write a snapshot of the complete simulation state to a file.
+ *
+ *  To never leave a partially written snapshot behind, e.g. if the job is killed while writing,
+ *  the data is first written to a temporary file which then replaces the target file.
+ */
+void write_snapshot (
+        string filename  ///< [in] name of (or path to) snapshot file
+        )
+{
+    if (!quiet) cout << " writing snapshot to " << filename << " at t=" << current_t << ", " << n_events << " events..." << endl;
+    string tmp_filename = filename + ".tmp";
+    snapshot_writer w;
+    w.f.open(tmp_filename, std::ios::binary);
+    if (!w.f) throw "cannot write snapshot file";
+
+    // header and structure:
+    snapshot_header h = {};
+    memcpy(h.magic, snapshot_magic, 8);
+    h.version = SNAPSHOT_VERSION;
+    h.sizeof_entity = sizeof(entity);
+    h.sizeof_outleg = sizeof(outleg);
+    h.sizeof_inleg = sizeof(inleg);
+    h.sizeof_event = sizeof(event);
+    h.sizeof_event_data = sizeof(event_data);
+    w.put(h);
+    w.pad();
+    put_labels(w, et2label);
+    put_labels(w, rat2label);
+
+    // scalars:
+    snapshot_scalars s = {
+            .current_t = current_t, .last_dt = last_dt,
+            .n_events = n_events,
+            .cumulative_logl = cumulative_logl,
+            .total_finite_effective_rate = total_finite_effective_rate,
+            .n_infinite_effective_rates = n_infinite_effective_rates, .n_links = n_links, .n_angles = n_angles,
+            .seed = seed, .replicate = replicate,
+            .max_e = max_e };
+    w.put(s);
+
+    // random generator incl. buffered numbers:
+    w.put(random_variable);
+    w.pad();
+    w.put_array(exponentials, EXPONENTIAL_BATCH);
+    w.put((int64_t) next_exponential_pos);
+
+    // entities:
+    w.put_array(e2et + 1, max_e);
+    vector<string> labels;
+    for (entity e = 1; e <= max_e; e++) labels.push_back(e2label.at(e));
+    w.put_strings(labels);
+    vector<snapshot_entity_count> entity_counts;
+    for (auto& [et, n] : et2n) entity_counts.push_back({ et, n });
+    w.put_vector(entity_counts);
+
+    // network, in compressed sparse row format (offsets by entity plus all legs):
+    vector<uint64_t> offsets = { 0 };
+    for (entity e = 1; e <= max_e; e++) offsets.push_back(offsets.back() + e2outs.at(e).size());
+    w.put_vector(offsets);
+    w.put(offsets.back());
+    for (entity e = 1; e <= max_e; e++) {
+        auto& outs = e2outs.at(e);
+        w.put_raw(&*outs.begin(), outs.size() * sizeof(outleg));
+    }
+    w.pad();
+    offsets = { 0 };
+    for (entity e = 1; e <= max_e; e++) offsets.push_back(offsets.back() + e2ins.at(e).size());
+    w.put_vector(offsets);
+    w.put(offsets.back());
+    for (entity e = 1; e <= max_e; e++) {
+        auto& ins = e2ins.at(e);
+        w.put_raw(&*ins.begin(), ins.size() * sizeof(inleg));
+    }
+    w.pad();
+    vector<snapshot_link_count> link_counts;
+    for (auto& [lt, n] : lt2n) link_counts.push_back({ lt.et1, lt.rat13, lt.et3, n });
+    w.put_vector(link_counts);
+
+    // schedule, in order of time:
+    assert (t2ev.size() == ev2data.size());
+    vector<snapshot_event> events(t2ev.size());
+    memset((void*) events.data(), 0, events.size() * sizeof(snapshot_event));  // so that padding bytes are defined
+    size_t i = 0;
+    for (auto& [t, ev] : t2ev) {
+        events[i].ev = ev;
+        events[i].evd = ev2data.at(ev);
+        i++;
+    }
+    w.put_vector(events);
+
+    w.f.close();
+    if (!w.f) throw "cannot write snapshot file";
+    if (rename(tmp_filename.c_str(), filename.c_str()) != 0) throw "cannot rename temporary snapshot file";
+    if (!quiet) cout << "  ...done." << endl;
+}
+
+/** Restore the complete simulation state from a snapshot file written by write_snapshot().
+ *
+ *  Must be called after the config has been read and the event constants have been initialized,
+ *  instead of generating entities, initial links and the initial schedule.
+ *  Generated gexf and tlog files get the suffix "_from<no. of events>" so that those of the interrupted run are kept.
+ */
+void restore_snapshot (
+        string filename  ///< [in] name of (or path to) snapshot file
+        )
+{
+    if (!silent) cout << " restoring snapshot from " << filename << " ..." << endl;
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd == -1) throw "cannot open snapshot file";
+    struct stat st;
+    if (fstat(fd, &st) == -1) { close(fd); throw "cannot open snapshot file"; }
+    size_t size = st.st_size;
+    auto data = (const char*) mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) throw "cannot map snapshot file";
+    madvise((void*) data, size, MADV_SEQUENTIAL);
+    snapshot_reader r = { .data = data, .size = size };
+
+    // header and structure:
+    auto h = r.get<snapshot_header>();
+    r.skip_pad();
+    if (memcmp(h.magic, snapshot_magic, 8) != 0) throw "not a tricl snapshot file";
+    if (h.version != SNAPSHOT_VERSION) throw "unsupported snapshot version";
+    if ((h.sizeof_entity != sizeof(entity)) || (h.sizeof_outleg != sizeof(outleg)) || (h.sizeof_inleg != sizeof(inleg))
+            || (h.sizeof_event != sizeof(event)) || (h.sizeof_event_data != sizeof(event_data))) throw
+            "snapshot was written by an incompatible build of tricl";
+    check_labels(r, et2label, "entity types in snapshot do not match config file");
+    check_labels(r, rat2label, "relationship or action types in snapshot do not match config file");
+
+    // scalars:
+    auto s = r.get<snapshot_scalars>();
+    if (s.max_e >= MAX_N_E) throw "too many entities in snapshot (recompile with larger E_BITS?)";
+    current_t = s.current_t;
+    last_dt = s.last_dt;
+    n_events = s.n_events;
+    cumulative_logl = s.cumulative_logl;
+    total_finite_effective_rate = s.total_finite_effective_rate;
+    n_infinite_effective_rates = s.n_infinite_effective_rates;
+    n_links = s.n_links;
+    n_angles = s.n_angles;
+    seed = s.seed;
+    replicate = s.replicate;
+    max_e = s.max_e;
+
+    // random generator:
+    random_variable = r.get<philox4x32>();
+    r.skip_pad();
+    auto [exps, n_exps] = r.get_array<double>();
+    if (n_exps != EXPONENTIAL_BATCH) throw "snapshot was written by an incompatible build of tricl";
+    memcpy(exponentials, exps, sizeof(exponentials));
+    next_exponential_pos = r.get<int64_t>();
+
+    // entities:
+    auto [ets, n_ets] = r.get_array<entity_type>();
+    auto labels = r.get_strings();
+    if ((n_ets != (uint64_t) max_e) || (labels.size() != n_ets)) throw "snapshot file is truncated or corrupt";
+    es.clear(); et2es.clear(); e2label.clear(); label2e.clear();
+    es.reserve(max_e); e2label.reserve(max_e); label2e.reserve(max_e);
+    for (entity e = 1; e <= max_e; e++) {
+        auto et = ets[e-1];
+        e2et[e] = et;
+        es.insert(e);
+        et2es[et].push_back(e);
+        e2label[e] = labels[e-1];
+        label2e[labels[e-1]] = e;
+    }
+    auto [entity_counts, n_entity_counts] = r.get_array<snapshot_entity_count>();
+    et2n.clear();
+    for (uint64_t i = 0; i < n_entity_counts; i++) et2n[entity_counts[i].et] = entity_counts[i].n;
+
+    // network:
+    e2outs.clear(); e2ins.clear();
+    e2outs.reserve(max_e); e2ins.reserve(max_e);
+    auto [out_offsets, n_out_offsets] = r.get_array<uint64_t>();
+    auto [outs, n_outs] = r.get_array<outleg>();
+    if ((n_out_offsets != (uint64_t) max_e + 1) || (out_offsets[max_e] != n_outs)) throw "snapshot file is truncated or corrupt";
+    for (entity e = 1; e <= max_e; e++) {
+        e2outs[e] = outleg_set(boost::container::ordered_unique_range, outs + out_offsets[e-1], outs + out_offsets[e]);
+    }
+    auto [in_offsets, n_in_offsets] = r.get_array<uint64_t>();
+    auto [ins, n_ins] = r.get_array<inleg>();
+    if ((n_in_offsets != (uint64_t) max_e + 1) || (in_offsets[max_e] != n_ins)) throw "snapshot file is truncated or corrupt";
+    for (entity e = 1; e <= max_e; e++) {
+        e2ins[e] = inleg_set(boost::container::ordered_unique_range, ins + in_offsets[e-1], ins + in_offsets[e]);
+    }
+    auto [link_counts, n_link_counts] = r.get_array<snapshot_link_count>();
+    for (uint64_t i = 0; i < n_link_counts; i++) {
+        auto& lc = link_counts[i];
+        lt2n[{ (entity_type) lc.et1, lc.rat13, (entity_type) lc.et3 }] = lc.n;
+    }
+
+    // schedule (stored in order of time, so each event can be appended at the end of t2ev):
+    auto [events, n_scheduled] = r.get_array<snapshot_event>();
+    ev2data.clear(); t2ev.clear();
+    ev2data.reserve(n_scheduled);
+    for (uint64_t i = 0; i < n_scheduled; i++) {
+        auto& rec = events[i];
+        ev2data.emplace(rec.ev, rec.evd);
+        t2ev.emplace_hint(t2ev.end(), rec.evd.t, rec.ev);
+    }
+
+    munmap((void*) data, size);
+
+    // keep gexf and tlog output of the interrupted run:
+    add_output_filename_suffix("_from" + to_string(n_events));
+
+    if (!silent) cout << "  ...done: t=" << current_t << ", " << n_events << " events, " << max_e << " entities, "
+            << n_links << " links, " << t2ev.size() << " scheduled events." << endl;
+}
+
+/** Determine when the first snapshot is due.
+ *
+ *  Snapshots are due at multiples of \ref snapshot_dt and \ref snapshot_n_events,
+ *  so that a resumed run writes them at the same points as an uninterrupted one.
+ */
+void init_snapshots ()
+{
+    if (snapshot_filename == "") return;
+    next_snapshot_t = (snapshot_dt < INFINITY) ? (floor(current_t / snapshot_dt) + 1) * snapshot_dt : INFINITY;
+    next_snapshot_n_events = (snapshot_n_events < LONG_MAX) ? (n_events / snapshot_n_events + 1) * snapshot_n_events : LONG_MAX;
+}
+
+/** Write a snapshot if one is due, i.e., if a multiple of \ref snapshot_dt or \ref snapshot_n_events has been passed.
+ */
+void write_snapshot_if_due ()
+{
+    if ((current_t >= next_snapshot_t) || (n_events >= next_snapshot_n_events)) {
+        write_snapshot(snapshot_filename);
+        init_snapshots();
+    }
+}
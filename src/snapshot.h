@@ -0,0 +1,17 @@
+// make sure this file is only included once:
+#ifndef INC_SNAPSHOT_H
+#define INC_SNAPSHOT_H
+
+#include "data_model.h"
+
+#define SNAPSHOT_VERSION 2  ///< Version of the binary snapshot format, to be increased whenever the format changes
+
+void write_snapshot (string filename);
+
+void restore_snapshot (string filename);
+
+void init_snapshots ();
+
+void write_snapshot_if_due ();
+
+#endif
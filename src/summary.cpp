@@ -0,0 +1,183 @@
+/** Non-performance-critical handling of the samplers of summary events (see \ref summary.h).
+ *
+ *  \file
+ */
+
+#include <assert.h>
+#include <algorithm>
+#include <iostream>
+
+#include "global_variables.h"
+#include "entity.h"
+#include "event.h"
+#include "summary.h"
+
+summary_sampler* lt2summary_sampler[MAX_N_SUMMARY_LT] = {};
+vector<int> e2pos;
+vector<summary_sampler*> changed_summary_samplers;
+
+vector<summary_sampler> summary_samplers;  ///< All samplers (not resized after \ref init_summary_samplers, so pointers stay valid)
+
+/** Count the covered pairs of all summary events from scratch.
+ *
+ *  \returns the no. of covered pairs by summary event type index and source entity position
+ */
+static vector<vector<long int>> count_summary_coverage ()
+{
+    vector<vector<long int>> counts(summary_samplers.size());
+    vector<int> lt2sampler(MAX_N_SUMMARY_LT, -1);
+    for (size_t i = 0; i < summary_samplers.size(); i++) {
+        auto& s = summary_samplers[i];
+        lt2sampler[SUMMARY_LT_INDEX(s.et1, s.rat13, s.et3)] = i;
+        counts[i].assign(et2es[s.et1].size(), et2es[s.et3].size() - ((s.et1 == s.et3) ? 1 : 0));
+    }
+    // linked pairs are not covered:
+    for (entity e1 = 1; e1 <= max_e; e1++) {
+        for (auto& l : e2outs[e1]) {
+            if (l.e_target == e1) continue;  // (identity)
+            auto i = lt2sampler[SUMMARY_LT_INDEX(e2et[e1], l.rat_out, e2et[l.e_target])];
+            if (i >= 0) counts[i][e2pos[e1]]--;
+        }
+    }
+    // separately scheduled pairs are not covered:
+    for (auto& [ev, evd] : ev2data) {
+        if ((ev.ec != EC_EST) || event_is_summary(ev)) continue;
+        auto i = lt2sampler[SUMMARY_LT_INDEX(e2et[ev.e1], ev.rat13, e2et[ev.e3])];
+        if (i >= 0) counts[i][e2pos[ev.e1]]--;
+    }
+    return counts;
+}
+
+/** Set up the samplers of all scheduled summary events from the current network and schedule.
+ *
+ *  To be called at the end of initialization. If reschedule is true, the summary events are rescheduled
+ *  at the rate of their covered pairs (necessary if they were scheduled without sampler),
+ *  otherwise their scheduled times are kept (when resuming, they were already drawn at the rate of the same bound).
+ */
+void init_summary_samplers (bool reschedule)
+{
+    std::fill(lt2summary_sampler, lt2summary_sampler + MAX_N_SUMMARY_LT, nullptr);
+    changed_summary_samplers.clear();
+    summary_samplers.clear();
+    e2pos.assign(max_e + 1, -1);
+    for (auto& [et, es] : et2es) {
+        for (size_t pos = 0; pos < es.size(); pos++) e2pos[es[pos]] = pos;
+    }
+    for (auto& [ev, evd] : ev2data) {
+        if (!event_is_summary(ev)) continue;
+        auto et1 = summary_et1(ev), et3 = summary_et3(ev);
+        summary_samplers.push_back({ .summary_ev = ev, .et1 = et1, .et3 = et3, .rat13 = ev.rat13,
+            .n_pairs = (double) et2n[et1] * et2n[et3] });
+    }
+    // (in a fixed order, since rescheduling draws random numbers:)
+    sort(summary_samplers.begin(), summary_samplers.end(), [](const summary_sampler& a, const summary_sampler& b) {
+        return SUMMARY_LT_INDEX(a.et1, a.rat13, a.et3) < SUMMARY_LT_INDEX(b.et1, b.rat13, b.et3);
+    });
+
+    // build the Fenwick trees from the counts in linear time:
+    auto counts = count_summary_coverage();
+    for (size_t i = 0; i < summary_samplers.size(); i++) {
+        auto& s = summary_samplers[i];
+        auto& tree = s.tree;
+        auto n = counts[i].size();
+        tree.assign(n + 1, 0);
+        s.n_covered = 0;
+        for (size_t pos = 0; pos < n; pos++) {
+            tree[pos + 1] = counts[i][pos];
+            s.n_covered += counts[i][pos];
+        }
+        for (size_t j = 1; j <= n; j++) {
+            auto parent = j + (j & -j);
+            if (parent <= n) tree[parent] += tree[j];
+        }
+        s.n_covered_bound = summary_bound(s.n_covered);
+        s.changed = false;
+        lt2summary_sampler[SUMMARY_LT_INDEX(s.et1, s.rat13, s.et3)] = &s;
+    }
+
+    if (reschedule) {
+        for (auto& s : summary_samplers) {
+            event_type evt = { .ec = EC_EST, s.et1, s.rat13, s.et3 };
+            reschedule_event(s.summary_ev, &ev2data.at(s.summary_ev), evt2left_tail.at(evt), evt2right_tail.at(evt));
+        }
+    }
+    if (verbose) cout << " set up samplers for " << summary_samplers.size() << " summary events" << endl;
+}
+
+/** Reschedule all summary events whose bound of the no. of covered pairs changed since they were scheduled.
+ *
+ *  To be called after each performed event, before the next event is popped.
+ */
+void reschedule_changed_summary_events ()
+{
+    for (auto s : changed_summary_samplers) {
+        s->changed = false;
+        if (summary_bound(s->n_covered) != s->n_covered_bound) {
+            event_type evt = { .ec = EC_EST, s->et1, s->rat13, s->et3 };
+            reschedule_event(s->summary_ev, &ev2data.at(s->summary_ev), evt2left_tail.at(evt), evt2right_tail.at(evt));
+        }
+    }
+    changed_summary_samplers.clear();
+}
+
+/** Draw a target entity uniformly from the covered pairs of source entity e1.
+ *
+ *  First tries drawing uniformly from all targets and rejecting uncovered ones
+ *  (fast unless most targets are uncovered), then enumerates the covered targets.
+ *
+ *  \returns the target entity
+ */
+entity random_summary_target (
+        const summary_sampler& s,  ///< [in] the sampler of the summary event
+        entity e1                  ///< [in] the source entity, which must have at least one covered pair
+        )
+{
+    [[maybe_unused]] event_type evt = { .ec = EC_EST, s.et1, s.rat13, s.et3 };  // (for profiling)
+    for (int i = 0; i < SUMMARY_REJECTION_TRIES; i++) {
+        auto e3 = random_entity(s.et3);
+        if (summary_covers(e1, s.rat13, e3)) return e3;
+        PROFILE_COUNT(PROF_SUMMARY_DRAW);
+        PROFILE_EVT(evt, summary_draws, 1);
+        if (e1 == e3) {
+            PROFILE_COUNT(PROF_SUMMARY_REJECT_EQUAL);
+            PROFILE_EVT(evt, reject_equal, 1);
+        } else if (e2outs[e1].count({ .rat_out = s.rat13, .e_target = e3 }) > 0) {
+            PROFILE_COUNT(PROF_SUMMARY_REJECT_EXISTS);
+            PROFILE_EVT(evt, reject_exists, 1);
+        } else {
+            PROFILE_COUNT(PROF_SUMMARY_REJECT_SEPARATE);
+            PROFILE_EVT(evt, reject_separate, 1);
+        }
+    }
+    // no. of covered pairs of e1 from the Fenwick tree:
+    auto& tree = s.tree;
+    long int n = 0;
+    for (size_t i = e2pos[e1] + 1; i > 0; i -= i & -i) n += tree[i];
+    for (size_t i = e2pos[e1]; i > 0; i -= i & -i) n -= tree[i];
+    assert (n > 0);
+    long int k = floor(uniform(random_variable) * n);
+    for (auto e3 : et2es[s.et3]) {
+        if (summary_covers(e1, s.rat13, e3) && (k-- == 0)) return e3;
+    }
+    throw "inconsistent summary event sampler";
+}
+
+/** Verify that the samplers' counts agree with counts from scratch.
+ */
+void verify_summary_samplers ()
+{
+    if (summary_samplers.empty()) return;
+    auto counts = count_summary_coverage();
+    for (size_t i = 0; i < summary_samplers.size(); i++) {
+        auto& s = summary_samplers[i];
+        long int total = 0;
+        for (size_t pos = 0; pos < counts[i].size(); pos++) {
+            long int n = 0;
+            for (size_t j = pos + 1; j > 0; j -= j & -j) n += s.tree[j];
+            for (size_t j = pos; j > 0; j -= j & -j) n -= s.tree[j];
+            assert (n == counts[i][pos]);
+            total += counts[i][pos];
+        }
+        assert (total == s.n_covered);
+    }
+}
@@ -0,0 +1,124 @@
+// make sure this file is only included once:
+#ifndef INC_SUMMARY_H
+#define INC_SUMMARY_H
+
+/** Performance-critical inline functions for sampling the entity pairs covered by summary events.
+ *
+ *  \file
+ *
+ *  A summary event stands for the establishment events of all pairs (e1, e3) of its entity types
+ *  that are not linked, not equal, and not scheduled separately ("covered" pairs).
+ *  Drawing pairs uniformly from all pairs and rejecting uncovered ones wastes most draws in dense
+ *  or clustered networks, each costing a rescheduling of the summary event.
+ *  Instead, a \ref summary_sampler keeps the no. of covered pairs of each source entity in a Fenwick tree,
+ *  so that a covered pair can be drawn exactly uniformly: e1 with probability proportional to its no. of covered pairs,
+ *  then e3 uniformly from the covered targets of e1.
+ *
+ *  Rescheduling the summary event whenever its no. of covered pairs n changes would still cost one rescheduling
+ *  per performed event. Hence it is scheduled at the rate of an upper bound to n, \ref summary_bound(n),
+ *  which only changes when n crosses one of a few quantization levels, and each draw is accepted
+ *  with probability n / bound before the pair is drawn (thinning), so that accepted draws happen at the rate of n.
+ *
+ *  The counts are updated whenever a link is added or deleted and whenever an establishment event
+ *  is scheduled separately or removed. At the end of \ref perform_event, only those summary events
+ *  whose bound changed are rescheduled (which is exact since waiting times are memoryless).
+ */
+
+#include "global_variables.h"
+#include "probability.h"
+
+#define SUMMARY_REJECTION_TRIES 64  ///< No. of tries to draw a covered target by rejection before enumerating them
+#define SUMMARY_BOUND_BITS 4        ///< No. of bits of the no. of covered pairs kept by \ref summary_bound()
+
+/** Sampler of the covered pairs of a summary event.
+ */
+struct summary_sampler
+{
+    event summary_ev;           ///< The summary event
+    entity_type et1, et3;       ///< Its source and target entity types
+    relationship_or_action_type rat13;  ///< Its relationship or action type
+    double n_pairs;             ///< No. of all pairs of its entity types (its attempt rate is that of one pair times this)
+    vector<long int> tree;      ///< Fenwick tree over the positions of source entities in et2es[et1] of their no. of covered pairs
+    long int n_covered;         ///< Current total no. of covered pairs
+    long int n_covered_bound;   ///< Upper bound to n_covered used for scheduling the summary event
+    bool changed;               ///< Whether the bound of n_covered changed since then
+};
+
+#define SUMMARY_LT_INDEX(et1, rat13, et3) ((size_t)(et1) ^ ((size_t)(rat13) << ET_BITS) ^ ((size_t)(et3) << (ET_BITS+RAT_BITS)))
+#define MAX_N_SUMMARY_LT (1 << (2*ET_BITS+RAT_BITS))
+
+extern summary_sampler* lt2summary_sampler[MAX_N_SUMMARY_LT];  ///< Sampler by link type (if nullptr, none or not initialized yet)
+extern vector<int> e2pos;                                       ///< Position of each entity in et2es[e2et[e]]
+extern vector<summary_sampler*> changed_summary_samplers;       ///< Samplers whose summary event may need rescheduling
+
+/** \returns the sampler of a summary event (or nullptr if not initialized)
+ */
+inline summary_sampler* summary_sampler_of (const event& summary_ev)
+{
+    return lt2summary_sampler[SUMMARY_LT_INDEX(-summary_ev.e1, summary_ev.rat13, -summary_ev.e3)];
+}
+
+/** Round the no. of covered pairs up to a multiple of a power of two,
+ *  keeping its leading \ref SUMMARY_BOUND_BITS + 1 bits.
+ *
+ *  \returns an upper bound to n that is exceeded by at most n / 2^SUMMARY_BOUND_BITS
+ */
+inline long int summary_bound (long int n)
+{
+    int shift = 0;
+    while ((n >> shift) >= (2L << SUMMARY_BOUND_BITS)) shift++;
+    long int mask = (1L << shift) - 1;
+    return (n + mask) & ~mask;
+}
+
+/** Register that the pair (e1, e3) became covered (delta = 1) or uncovered (delta = -1)
+ *  by the summary event of its link type, if any.
+ */
+inline void change_summary_coverage (entity e1, relationship_or_action_type rat13, entity e3, long int delta)
+{
+    auto s = lt2summary_sampler[SUMMARY_LT_INDEX(e2et[e1], rat13, e2et[e3])];
+    if (s == nullptr) return;
+    auto& tree = s->tree;
+    for (size_t i = e2pos[e1] + 1; i < tree.size(); i += i & -i) tree[i] += delta;
+    s->n_covered += delta;
+    if (!s->changed && (summary_bound(s->n_covered) != s->n_covered_bound)) {
+        s->changed = true;
+        changed_summary_samplers.push_back(s);
+    }
+}
+
+/** \returns whether the pair (e1, e3) is covered by the summary event of its link type
+ */
+inline bool summary_covers (entity e1, relationship_or_action_type rat13, entity e3)
+{
+    return (e1 != e3)
+            && (e2outs[e1].count({ .rat_out = rat13, .e_target = e3 }) == 0)
+            && (ev2data.count({ .ec = EC_EST, e1, rat13, e3 }) == 0);
+}
+
+/** Draw a covered source entity with probability proportional to its no. of covered pairs.
+ */
+inline entity random_summary_source (const summary_sampler& s)
+{
+    auto& tree = s.tree;
+    long int u = floor(uniform(random_variable) * s.n_covered);
+    size_t pos = 0, step = 1;
+    while (2 * step < tree.size()) step *= 2;
+    for (; step > 0; step /= 2) {
+        if ((pos + step < tree.size()) && (tree[pos + step] <= u)) {
+            pos += step;
+            u -= tree[pos];
+        }
+    }
+    return et2es[s.et1][pos];
+}
+
+void init_summary_samplers (bool reschedule);
+
+void reschedule_changed_summary_events ();
+
+entity random_summary_target (const summary_sampler& s, entity e1);
+
+void verify_summary_samplers ();
+
+#endif
@@ -0,0 +1,142 @@
+/** Output of link establishments and terminations to a binary event log (.tlog file).
+ *
+ *  \file
+ *
+ *  See \ref tlog_format.h for the file format.
+ *  Records are collected column by column in memory, and each full block is handed over
+ *  to a background thread (see \ref async_writer.h) which compresses and writes it.
+ */
+
+#include <zlib.h>
+
+#include "global_variables.h"
+#include "async_writer.h"
+#include "tlog_format.h"
+#include "tlog.h"
+
+bool tlog_active = false;
+
+/** A block of records, stored column by column.
+ */
+struct tlog_block
+{
+    string codes, e1s, e3s, ts;  ///< Columns
+    uint32_t n_records = 0;      ///< No. of records
+};
+
+ofstream tlog_file;                   ///< The .tlog file
+tlog_block* tlog_current_block_;      ///< Block currently being filled
+uint64_t tlog_last_t_bits = 0;        ///< Bits of the time of the last record in the current block
+async_writer<tlog_block*> tlog_writer;  ///< Background thread compressing and writing full blocks
+
+/** Compress a block, write it to the file, and free it (called by the background thread).
+ */
+void write_tlog_block (tlog_block*& block_)
+{
+    string payload = block_->codes + block_->e1s + block_->e3s + block_->ts;
+    uLongf compressed_size = compressBound(payload.size());
+    string compressed(compressed_size, '\0');
+    // (compression can only fail for lack of memory, which we cannot handle here anyway)
+    compress2((Bytef*) compressed.data(), &compressed_size, (const Bytef*) payload.data(), payload.size(), TLOG_COMPRESSION_LEVEL);
+    uint32_t sizes[3] = { (uint32_t) compressed_size, block_->n_records, (uint32_t) payload.size() };
+    tlog_file.write((const char*) sizes, 12);
+    tlog_file.write(compressed.data(), compressed_size);
+    delete block_;
+}
+
+/** Hand the current block over to the background thread and start a new one.
+ */
+void hand_over_tlog_block ()
+{
+    tlog_writer.push(tlog_current_block_);
+    tlog_current_block_ = new tlog_block();
+    tlog_last_t_bits = 0;
+}
+
+/** Add a record to the current block.
+ */
+inline void add_tlog_record (
+        bool is_termination,  ///< [in] whether the link was terminated (otherwise established)
+        const tricllink& l,   ///< [in] the link
+        timepoint t           ///< [in] time of the establishment or termination
+        )
+{
+    auto& b = *tlog_current_block_;
+    tlog_put_varint(b.codes, (l.rat13 << 1) | (is_termination ? 1 : 0));
+    tlog_put_varint(b.e1s, l.e1);
+    tlog_put_varint(b.e3s, l.e3);
+    auto t_bits = tlog_time_bits(t);
+    tlog_put_varint(b.ts, t_bits ^ tlog_last_t_bits);
+    tlog_last_t_bits = t_bits;
+    if (++b.n_records == TLOG_BLOCK_RECORDS) hand_over_tlog_block();
+}
+
+/** Open the .tlog file, write its header, and record all current links as established at their start times.
+ */
+void init_tlog ()
+{
+    if (tlog_filename == "") return;
+    if (verbose) cout << " prepare tlog output file " << tlog_filename << endl;
+    tlog_file.open(tlog_filename, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+    if (!tlog_file) throw "cannot write tlog file";
+    tlog_active = true;
+
+    // header:
+    string buf(tlog_magic, 8);
+    uint32_t version = TLOG_VERSION;
+    buf.append((const char*) &version, 4);
+    buf.append((const char*) &max_t, 8);
+    tlog_put_varint(buf, et2label.size());
+    for (auto& [et, l] : et2label) {
+        tlog_put_varint(buf, et);
+        tlog_put_string(buf, l);
+    }
+    tlog_put_varint(buf, rat2label.size());
+    for (auto& [rat, l] : rat2label) {
+        tlog_put_varint(buf, rat);
+        tlog_put_varint(buf, rat2inv.at(rat));
+        tlog_put_string(buf, l);
+    }
+    tlog_put_varint(buf, max_e);
+    for (entity e = 1; e <= max_e; e++) {
+        tlog_put_varint(buf, e2et[e]);
+        tlog_put_string(buf, e2label.at(e));
+    }
+    tlog_file << buf;
+    tlog_current_block_ = new tlog_block();
+    tlog_writer.start(write_tlog_block);
+
+    // current links:
+    for (entity e1 = 1; e1 <= max_e; e1++) {
+        for (auto& leg : e2outs.at(e1)) {
+            if (leg.rat_out == RT_ID) continue;
+            tricllink l = { .e1 = e1, .rat13 = leg.rat_out, .e3 = leg.e_target };
+            add_tlog_record(false, l, leg.t_start);
+        }
+    }
+}
+
+/** Record the establishment or termination of a link at the current time.
+ */
+void tlog_output_link_event (
+        event_class ec,     ///< [in] EC_EST or EC_TERM
+        const tricllink& l  ///< [in] the link
+        )
+{
+    add_tlog_record(ec == EC_TERM, l, current_t);
+}
+
+/** Write the last block and the end marker and close the file.
+ */
+void finish_tlog ()
+{
+    if (!tlog_active) return;
+    if (!quiet) cout << " complete tlog output file " << tlog_filename << endl;
+    if (tlog_current_block_->n_records > 0) hand_over_tlog_block();
+    hand_over_tlog_block();  // empty block as end marker
+    tlog_writer.stop();
+    delete tlog_current_block_;
+    tlog_file.close();
+    tlog_active = false;
+    if (!tlog_file) throw "cannot write tlog file (disk full?)";
+}
@@ -0,0 +1,15 @@
+// make sure this file is only included once:
+#ifndef INC_TLOG_H
+#define INC_TLOG_H
+
+#include "data_model.h"
+
+extern bool tlog_active;  ///< Whether a .tlog file is being written
+
+void init_tlog ();
+
+void tlog_output_link_event (event_class ec, const tricllink& l);
+
+void finish_tlog ();
+
+#endif
@@ -0,0 +1,97 @@
+// make sure this file is only included once:
+#ifndef INC_TLOG_FORMAT_H
+#define INC_TLOG_FORMAT_H
+
+/** Binary event log format (.tlog), shared by tricl and the converter tricl_convert.
+ *
+ *  \file
+ *
+ *  A .tlog file records every establishment and termination of a (non-identity) link,
+ *  incl. inverse links, in order of time. It is much more compact than gexf output
+ *  and can be converted to gexf or csv by tricl_convert.
+ *
+ *  Layout (all integers little-endian, "varint" = LEB128-encoded unsigned integer):
+ *  - header: magic "TRICLLOG", uint32 version, then
+ *    - double max_t
+ *    - varint no. of entity types, then for each: varint id, string label
+ *    - varint no. of relationship or action types, then for each: varint id, varint inverse id (0: none), string label
+ *    - varint no. of entities (ids 1...n), then for each: varint entity type, string label
+ *    (where a string is a varint length followed by the characters)
+ *  - a sequence of blocks, each consisting of uint32 compressed payload size in bytes, uint32 no. of records,
+ *    uint32 uncompressed payload size in bytes, and the payload compressed with zlib (deflate, level 1).
+ *    The uncompressed payload stores the records' fields column by column,
+ *    so that similar values are adjacent, which helps the compression:
+ *    - codes: varint (rat13 << 1) | (1 if termination else 0)
+ *    - source entities: varint e1
+ *    - target entities: varint e3
+ *    - times: varint (bits of t) XOR (bits of previous t in block, 0 for the first).
+ *      Since records come in order of time, consecutive times share their leading bits,
+ *      so this is small and lossless.
+ *  - an empty block (no. of records 0) marks the regular end of the file.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <string>
+
+#define TLOG_VERSION 1              ///< Version of the .tlog format, to be increased whenever the format changes
+#define TLOG_BLOCK_RECORDS (1<<16)  ///< No. of records per block
+#define TLOG_COMPRESSION_LEVEL 1    ///< zlib compression level for blocks (fast)
+
+const char tlog_magic[8] = { 'T', 'R', 'I', 'C', 'L', 'L', 'O', 'G' };
+
+/** Append an unsigned integer in LEB128 encoding (7 bits per byte, high bit = more bytes follow).
+ */
+inline void tlog_put_varint (std::string& buf, uint64_t x)
+{
+    while (x >= 0x80) {
+        buf.push_back((char) (x | 0x80));
+        x >>= 7;
+    }
+    buf.push_back((char) x);
+}
+
+/** Read an unsigned integer in LEB128 encoding and advance p.
+ */
+inline uint64_t tlog_get_varint (const char*& p, const char* end)
+{
+    uint64_t x = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (p == end) throw "tlog file is truncated or corrupt";
+        uint8_t byte = *p++;
+        x |= (uint64_t) (byte & 0x7f) << shift;
+        if (byte < 0x80) return x;
+    }
+    throw "tlog file is truncated or corrupt";
+}
+
+inline void tlog_put_string (std::string& buf, const std::string& s)
+{
+    tlog_put_varint(buf, s.size());
+    buf += s;
+}
+
+inline std::string tlog_get_string (const char*& p, const char* end)
+{
+    auto n = tlog_get_varint(p, end);
+    if (n > (uint64_t) (end - p)) throw "tlog file is truncated or corrupt";
+    std::string s(p, n);
+    p += n;
+    return s;
+}
+
+inline uint64_t tlog_time_bits (double t)
+{
+    uint64_t bits;
+    memcpy(&bits, &t, 8);
+    return bits;
+}
+
+inline double tlog_bits_time (uint64_t bits)
+{
+    double t;
+    memcpy(&t, &bits, 8);
+    return t;
+}
+
+#endif
@@ -34,7 +34,6 @@
  * - add actions
  *
  * simulation options:
- * - as an alternative to tmax and max_n_events, add max_wall
  * - add a particle filtering mode
  *
  * network theory stuff:
@@ -57,10 +56,6 @@
  * input/output:
  * - include metadata into gexf files
  * - redirect messages to log file
- * - support "premerged" edges in gexf via <spells><spell start="..." end="..."></spell>...</spells>,
- *   by a postprocessing step that firts sorts and then merges the edges in the file by doing
- *   ``gunzip -c myoutput.gexf.gz | sort -t"-" -k3 | mergelinks | gzip > mysortedoutput.gexf.gz``
- *   for which we need to provide a binary "mergelinks"
  * - support prespecified positions in visualization, see here: <https://github.com/gephi/gephi/issues/2038>
  * - support entity type detection from columns in csv file
  *
@@ -208,10 +203,9 @@
 #include "simulate.h"
 #include "finish.h"
 #include "debugging.h"
+#include "snapshot.h"
 //#include "pfilter.h"
 
-string config_yaml_filename; ///< filename of configuration file
-
 /** main function of the tricl executable */
 int main (int argc, char *argv[])
 {
@@ -224,10 +218,19 @@ int main (int argc, char *argv[])
         if (debug) verify_data_consistency();
 
         // actual simulation:
+        init_progress();
         while (true)
         {
             if (!step()) break;
+            log_progress_if_due();
+            write_snapshot_if_due();
+            if (limits_reached_if_due()) {
+                // checkpoint to continue from, even if no snapshot file was specified:
+                if (snapshot_filename == "") snapshot_filename = config_yaml_filename + ((child_label != "") ? "_" + child_label : "") + ".snapshot";
+                break;
+            }
         }
+        if (snapshot_filename != "") write_snapshot(snapshot_filename);
 
         // stuff after simulation:
         finish();
@@ -235,6 +238,12 @@ int main (int argc, char *argv[])
     catch (const char* msg)
     {
       cerr << "ERROR: exiting with message: " << msg << endl;
+      return 1;
+    }
+    catch (const string& msg)
+    {
+      cerr << "ERROR: exiting with message: " << msg << endl;
+      return 1;
     }
     return 0;
 }